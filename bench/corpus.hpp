@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+#include "example_schema.hpp"
+
+// Deterministic benchmark corpus: the demo messages, many small generated
+// documents and a few large ones made by merging generated lists. Also the
+// training workload of the PGO build.
+template<class NodeDescription>
+inline std::vector<std::string> benchmark_corpus(NodeDescription desc, std::uint64_t seed = 1)
+{
+    std::mt19937_64 random(seed);
+    std::vector<std::string> corpus;
+    for (auto& message : example_messages()) corpus.push_back(message);
+    for (int i = 0; i < 2000; ++i)
+    {
+        NodeData data;
+        desc.generate(data, random);
+        corpus.push_back(serialize(data, desc));
+    }
+    for (int i = 0; i < 4; ++i)
+    {
+        NodeData large;
+        desc.generate(large, random);
+        for (int j = 0; j < 5000; ++j)
+        {
+            NodeData part;
+            desc.generate(part, random);
+            for (auto& [name, subnodes] : part.subnodes)
+            {
+                auto& target = large.subnodes[name];
+                target.insert(target.end(), subnodes.begin(), subnodes.end());
+            }
+        }
+        corpus.push_back(serialize(large, desc));
+    }
+    return corpus;
+}
@@ -0,0 +1,116 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+#include "example_schema.hpp"
+
+// Log-linear latency histogram in the style of HdrHistogram: values keep
+// subBucketBits of precision (about 1.5% relative error) up to 2^64 ns.
+class LatencyHistogram
+{
+public:
+    static inline constexpr unsigned subBucketBits = 6;
+
+    inline void record(std::uint64_t ns)
+    {
+        ++counts[index(ns)];
+        ++total;
+        if (ns > maximum) maximum = ns;
+    }
+    inline std::uint64_t percentile(double p) const
+    {
+        auto rank = static_cast<std::uint64_t>(p / 100.0 * total + 0.5);
+        if (rank == 0) rank = 1;
+        std::uint64_t seen = 0;
+        for (std::size_t i = 0; i < counts.size(); ++i)
+        {
+            seen += counts[i];
+            if (seen >= rank) return std::min(highest_equivalent(i), maximum);
+        }
+        return maximum;
+    }
+    inline std::uint64_t max() const { return maximum; }
+    inline std::uint64_t count() const { return total; }
+
+private:
+    static inline std::size_t index(std::uint64_t v)
+    {
+        if (v < (1u << subBucketBits)) return static_cast<std::size_t>(v);
+        unsigned shift = 63 - __builtin_clzll(v) - subBucketBits;
+        return ((shift + 1) << subBucketBits) + ((v >> shift) - (1u << subBucketBits));
+    }
+    static inline std::uint64_t highest_equivalent(std::size_t i)
+    {
+        if (i < (1u << subBucketBits)) return i;
+        unsigned shift = static_cast<unsigned>(i >> subBucketBits) - 1;
+        std::uint64_t top = (i & ((1u << subBucketBits) - 1)) + (1u << subBucketBits);
+        return ((top + 1) << shift) - 1;
+    }
+
+    std::vector<std::uint64_t> counts = std::vector<std::uint64_t>((65 - subBucketBits) << subBucketBits);
+    std::uint64_t total = 0;
+    std::uint64_t maximum = 0;
+};
+
+// Times every single operation on the example messages, once with a fresh
+// document per parse and once through a reused Parser, so the effect of
+// allocations and exceptions shows up in the tail percentiles.
+template<class NodeDescription, class Examples>
+inline void run_latency_benchmark(NodeDescription desc, const Examples& examples, std::size_t iterations)
+{
+    std::cout << std::left << std::setw(8) << "example" << std::setw(24) << "mode" << std::right
+              << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "p999"
+              << std::setw(12) << "max" << "  (ns, " << iterations << " ops)" << std::endl;
+
+    auto report = [&](std::size_t example, const char* mode, const LatencyHistogram& h) {
+        std::cout << std::left << std::setw(8) << example << std::setw(24) << mode << std::right
+                  << std::setw(10) << h.percentile(50) << std::setw(10) << h.percentile(99)
+                  << std::setw(10) << h.percentile(99.9) << std::setw(12) << h.max() << std::endl;
+    };
+    auto measure = [&](auto&& operation) {
+        LatencyHistogram histogram;
+        for (std::size_t i = 0; i < iterations / 10; ++i) operation();
+        for (std::size_t i = 0; i < iterations; ++i)
+        {
+            auto start = std::chrono::steady_clock::now();
+            operation();
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            histogram.record(static_cast<std::uint64_t>(ns));
+        }
+        return histogram;
+    };
+
+    std::size_t example = 0;
+    for (const auto& s : examples)
+    {
+        bool valid = true;
+        try { parse(s, desc); } catch (const std::exception&) { valid = false; }
+
+        Parser<NodeDescription> parser(desc);
+        auto parseOnce = [&] {
+            try { return parse(s, desc); } catch (const std::exception&) { return NodeData{}; }
+        };
+        auto parseReused = [&] {
+            try { return parser.parse(s); } catch (const std::exception&) { return NodeData{}; }
+        };
+
+        report(example, "parse", measure(parseOnce));
+        report(example, "parse (reused)", measure(parseReused));
+        if (valid)
+        {
+            report(example, "parse+serialize", measure([&] { return serialize(parseOnce(), desc); }));
+            report(example, "parse+serialize (reused)", measure([&] { return serialize(parseReused(), desc); }));
+        }
+        ++example;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    run_latency_benchmark(example_schema(), example_messages(), iterations);
+    return 0;
+}
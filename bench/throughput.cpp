@@ -0,0 +1,105 @@
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "corpus.hpp"
+
+// Parses and serializes the benchmark corpus `rounds` times and prints the
+// throughput per mode. The JSON, wire and stream modes, the batch mode (on a
+// WorkerPool with all CPUs) and the queue mode (streaming records to a
+// consumer thread) are not part of the total. The last line ("total ...
+// MB/s") is what the PGO pipeline compares between builds.
+template<class NodeDescription>
+inline void run_throughput_benchmark(NodeDescription desc, const std::vector<std::string>& corpus, std::size_t rounds)
+{
+    std::size_t bytes = 0;
+    for (auto& s : corpus) bytes += s.size();
+
+    auto measure = [&](const char* mode, auto&& operation) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t round = 0; round < rounds; ++round)
+            for (auto& s : corpus)
+            {
+                try { operation(s); } catch (const std::exception&) { }
+            }
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        std::cout << std::left << std::setw(16) << mode << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(10) << bytes * rounds / seconds.count() / 1e6 << " MB/s" << std::endl;
+        return seconds.count();
+    };
+
+    Parser<NodeDescription> parser(desc);
+    double total = 0;
+    total += measure("parse", [&](const std::string& s) { return parse(s, desc); });
+    total += measure("parse (reused)", [&](const std::string& s) { return parser.parse(s); });
+    total += measure("round trip", [&](const std::string& s) { return serialize(parse(s, desc), desc); });
+    std::string json;
+    measure("xml to json", [&](const std::string& s) { xml_to_json(s, desc, json); });
+    // Reads the JSON form of every document; the rate is of the xml bytes
+    std::vector<std::string> jsonCorpus;
+    for (auto& s : corpus)
+    {
+        try { jsonCorpus.push_back(xml_to_json(s, desc)); } catch (const std::exception&) { jsonCorpus.push_back(s); }
+    }
+    measure("parse json", [&](const std::string& s) { return parse_json(jsonCorpus[static_cast<std::size_t>(&s - corpus.data())], desc); });
+    // Decodes the wire form of every document, also at the rate of the xml
+    std::vector<std::string> wireCorpus;
+    for (auto& s : corpus)
+    {
+        try { wireCorpus.push_back(encode_wire(parse(s, desc), desc)); } catch (const std::exception&) { wireCorpus.push_back(s); }
+    }
+    measure("decode wire", [&](const std::string& s) { return decode_wire(wireCorpus[static_cast<std::size_t>(&s - corpus.data())], desc); });
+    // Parses the valid documents concatenated into one stream
+    std::string concatenated;
+    for (auto& s : corpus)
+    {
+        try { parse(s, desc); concatenated += s; } catch (const std::exception&) { }
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t round = 0; round < rounds; ++round)
+    {
+        std::istringstream in(concatenated);
+        parse_document_stream(in, desc, [](NodeData&&) { });
+    }
+    std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+    std::cout << std::left << std::setw(16) << "parse (stream)" << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << concatenated.size() * rounds / seconds.count() / 1e6 << " MB/s" << std::endl;
+
+    WorkerPool pool;
+    start = std::chrono::steady_clock::now();
+    for (std::size_t round = 0; round < rounds; ++round) parse_batch(pool, corpus, desc);
+    seconds = std::chrono::steady_clock::now() - start;
+    std::cout << std::left << std::setw(16) << "parse (batch)" << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << bytes * rounds / seconds.count() / 1e6 << " MB/s" << std::endl;
+
+    MpmcQueue<NodeData> queue(1024);
+    std::thread consumer([&] {
+        NodeData record;
+        while (queue.pop(record)) { }
+    });
+    start = std::chrono::steady_clock::now();
+    for (std::size_t round = 0; round < rounds; ++round)
+        for (auto& s : corpus)
+        {
+            try { parse_stream(s, desc, queue); } catch (const std::exception&) { }
+        }
+    queue.close();
+    consumer.join();
+    seconds = std::chrono::steady_clock::now() - start;
+    std::cout << std::left << std::setw(16) << "parse (queue)" << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << bytes * rounds / seconds.count() / 1e6 << " MB/s" << std::endl;
+    std::cout << std::left << std::setw(16) << "total" << std::right << std::fixed << std::setprecision(1)
+              << std::setw(10) << 3 * bytes * rounds / total / 1e6 << " MB/s" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::size_t rounds = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 5;
+    auto xml = example_schema();
+    run_throughput_benchmark(xml, benchmark_corpus(xml), rounds);
+    return 0;
+}
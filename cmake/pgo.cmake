@@ -0,0 +1,75 @@
+# Profile guided optimization pipeline, run as
+#   cmake -DSOURCE_DIR=<repo> -DBUILD_DIR=<dir> [-DPugiXML_DIR=...] -P cmake/pgo.cmake
+# or through the "pgo" target. Builds a baseline and an instrumented tree,
+# trains the instrumented bench_throughput on the benchmark corpus, rebuilds
+# the same tree with the collected profile and reports the throughput of both
+# builds. The tree is reused because GCC names profiles after object paths.
+
+if(NOT SOURCE_DIR OR NOT BUILD_DIR)
+    message(FATAL_ERROR "SOURCE_DIR and BUILD_DIR must be set")
+endif()
+if(NOT TRAINING_ROUNDS)
+    set(TRAINING_ROUNDS 3)
+endif()
+if(NOT MEASURE_ROUNDS)
+    set(MEASURE_ROUNDS 10)
+endif()
+
+set(profile_dir ${BUILD_DIR}/profile)
+set(common_args -DCMAKE_BUILD_TYPE=Release -DXML_PARSER_BUILD_EXAMPLES=OFF -DXML_PARSER_PGO_DIR=${profile_dir})
+foreach(variable PugiXML_DIR CMAKE_CXX_COMPILER CMAKE_PREFIX_PATH)
+    if(${variable})
+        list(APPEND common_args -D${variable}=${${variable}})
+    endif()
+endforeach()
+
+function(run)
+    execute_process(COMMAND ${ARGN} RESULT_VARIABLE result)
+    if(result)
+        message(FATAL_ERROR "Command failed: ${ARGN}")
+    endif()
+endfunction()
+
+function(build_tree name phase)
+    message(STATUS "Building ${name} (XML_PARSER_PGO=${phase})")
+    run(${CMAKE_COMMAND} -S ${SOURCE_DIR} -B ${BUILD_DIR}/${name} ${common_args} -DXML_PARSER_PGO=${phase})
+    run(${CMAKE_COMMAND} --build ${BUILD_DIR}/${name} --target bench_throughput)
+endfunction()
+
+function(measure name out)
+    execute_process(COMMAND ${BUILD_DIR}/${name}/bench_throughput ${MEASURE_ROUNDS}
+        OUTPUT_VARIABLE output RESULT_VARIABLE result)
+    if(result OR NOT output MATCHES "total +([0-9]+)\\.([0-9]) MB/s")
+        message(FATAL_ERROR "bench_throughput failed in ${name}:\n${output}")
+    endif()
+    message(STATUS "${name}:\n${output}")
+    # Tenths of MB/s, as math(EXPR) only handles integers
+    set(${out} ${CMAKE_MATCH_1}${CMAKE_MATCH_2} PARENT_SCOPE)
+endfunction()
+
+file(REMOVE_RECURSE ${profile_dir})
+build_tree(baseline "")
+build_tree(optimized GENERATE)
+
+message(STATUS "Training on the benchmark corpus")
+run(${BUILD_DIR}/optimized/bench_throughput ${TRAINING_ROUNDS})
+file(GLOB raw_profiles ${profile_dir}/*.profraw)
+if(raw_profiles)
+    find_program(LLVM_PROFDATA NAMES llvm-profdata REQUIRED)
+    run(${LLVM_PROFDATA} merge -output=${profile_dir}/default.profdata ${raw_profiles})
+endif()
+
+build_tree(optimized USE)
+
+measure(baseline baseline_mbps)
+measure(optimized optimized_mbps)
+math(EXPR change "(${optimized_mbps} - ${baseline_mbps}) * 1000 / ${baseline_mbps}")
+# Formatted from the magnitude so a change between -1% and 0% keeps its sign
+set(change_sign "")
+if(change LESS 0)
+    set(change_sign "-")
+    math(EXPR change "0 - ${change}")
+endif()
+math(EXPR change_percent "${change} / 10")
+math(EXPR change_fraction "${change} % 10")
+message(STATUS "PGO speedup: ${change_sign}${change_percent}.${change_fraction}% (binaries in ${BUILD_DIR}/optimized)")
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <xml_parser.hpp>
+
+inline auto example_schema()
+{
+    return
+        "root"_node(
+            Required(),
+            "key"_attr(Required()),
+            "client_id"_attr("anonymous"_default),
+            NodeList(
+                "attachment"_node(
+                    "name"_attr(Required()),
+                    Text(Required(), Base64()))),
+            NodeList(
+                "data"_node(
+                    "id"_attr(Required()),
+                    "priority"_attr("low|normal|high"_enum, "normal"_default),
+                    "at"_attr(Iso8601()),
+                    "amount"_attr(FixedPoint<2>()),
+                    "digest"_attr(Hex()),
+                    Text(Required()))));
+}
+
+inline std::vector<std::string> example_messages()
+{
+    return {
+        "<wrong />"s,
+        "<root />"s,
+        "<root key=\"mykey\" />"s,
+        "<root key=\"mykey\"><data id=\"1\" /></root>"s,
+        "<root key=\"mykey\"><data id=\"1\" at=\"2024-05-01T12:00:00.25+02:00\">D1</data><data id=\"2\" priority=\"high\">D2</data></root>"s
+    };
+}
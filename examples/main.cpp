@@ -0,0 +1,54 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include "example_schema.hpp"
+
+int main(int argc, char** argv)
+{
+    const char* profilePath = nullptr;
+    const char* metricsPath = nullptr;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!std::strcmp(argv[i], "--profile") && i + 1 < argc) profilePath = argv[++i];
+        else if (!std::strcmp(argv[i], "--metrics") && i + 1 < argc) metricsPath = argv[++i];
+    }
+    if (metricsPath) MetricsRegistry::global().enable();
+    ParseProfiler profiler;
+
+    auto xml = example_schema();
+    auto examples = example_messages();
+    for (const auto& s : examples)
+    {
+        try
+        {
+            std::cout << "== Example: " << s << std::endl;
+            auto root = profilePath ? parse(s, xml, profiler) : parse(s, xml);
+            std::cout << "OK" << std::endl;
+
+            auto dataNodeCount = root.subnodes["data"].size();
+            std::cout << "KEY: " << root.attributes["key"] << '\n'
+                      << "CLIENT: " << "client_id"_attr("anonymous"_default).get(root) << '\n'
+                      << "Data subnode count: " << dataNodeCount << '\n'
+                      << "Data1 value: " << (dataNodeCount > 0 ? root.subnodes["data"].at(0).text : "") << '\n'
+                      << "Data2 value: " << (dataNodeCount > 1 ? root.subnodes["data"].at(1).text : "") << '\n'
+                      << "Data2 priority: " << (dataNodeCount > 1 ? "priority"_attr("low|normal|high"_enum, "normal"_default).get(root.subnodes["data"].at(1)) : "") << '\n'
+                      << std::flush;
+
+            std::cout << "Serialized: " << serialize(root, xml) << std::endl;
+            std::cout << "JSON: " << xml_to_json(s, xml) << std::endl;
+        }
+        catch(const std::exception& e)
+        {
+            std::cout << e.what() << std::endl;
+        }
+    }
+
+    if (profilePath)
+    {
+        std::ofstream out(profilePath);
+        profiler.write_folded(out);
+    }
+    if (metricsPath) MetricsRegistry::global().write_exposition(metricsPath);
+
+    return 0;
+}
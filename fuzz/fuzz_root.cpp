@@ -0,0 +1,90 @@
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <pugixml.hpp>
+#include "example_schema.hpp"
+
+// libFuzzer entry point. Besides crashes it traps on inputs that break the
+// parse/serialize round trip or whose parse time or allocation count grows
+// faster than linearly with the input size (XML_PARSER_FUZZ_NS_PER_BYTE,
+// XML_PARSER_FUZZ_ALLOCS_PER_BYTE and XML_PARSER_FUZZ_DOM_BYTES_PER_BYTE
+// adjust the bounds). Allocations count those of pugixml's DOM, which go
+// through malloc rather than operator new.
+
+static std::size_t fuzzAllocations = 0;
+static std::size_t fuzzDomBytes = 0;
+
+void* operator new(std::size_t size)
+{
+    ++fuzzAllocations;
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+static void* fuzz_dom_allocate(std::size_t size)
+{
+    ++fuzzAllocations;
+    fuzzDomBytes += size;
+    return std::malloc(size);
+}
+
+inline std::size_t fuzz_bound(const char* variable, std::size_t fallback)
+{
+    const char* value = std::getenv(variable);
+    return value ? std::strtoull(value, nullptr, 10) : fallback;
+}
+
+template<class NodeDescription>
+inline void fuzz_schema(const std::string& s, NodeDescription desc)
+{
+    static const std::size_t nsPerByte = fuzz_bound("XML_PARSER_FUZZ_NS_PER_BYTE", 2000);
+    static const std::size_t allocsPerByte = fuzz_bound("XML_PARSER_FUZZ_ALLOCS_PER_BYTE", 4);
+    static const std::size_t domBytesPerByte = fuzz_bound("XML_PARSER_FUZZ_DOM_BYTES_PER_BYTE", 64);
+    auto fail = [&](const std::string& why) {
+        std::cerr << why << " (" << s.size() << " bytes)" << std::endl;
+        std::abort();
+    };
+
+    NodeData root;
+    bool valid = true;
+    fuzzAllocations = 0;
+    fuzzDomBytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    try { root = parse(s, desc); } catch (const std::exception&) { valid = false; }
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    auto allocations = fuzzAllocations;
+    auto domBytes = fuzzDomBytes;
+
+    if (static_cast<std::size_t>(ns) > 1000000 + nsPerByte * s.size())
+        fail("Parse time " + std::to_string(ns) + "ns exceeds linear bound");
+    if (allocations > 64 + allocsPerByte * s.size())
+        fail("Parse made " + std::to_string(allocations) + " allocations, exceeding linear bound");
+    // pugixml allocates its DOM in pages of about 32 KiB
+    if (domBytes > 256 * 1024 + domBytesPerByte * s.size())
+        fail("Parse allocated " + std::to_string(domBytes) + " DOM bytes, exceeding linear bound");
+    if (!valid) return;
+
+    auto serialized = serialize(root, desc);
+    NodeData reparsed;
+    try { reparsed = parse(serialized, desc); }
+    catch (const std::exception& e) { fail("Serialized document does not parse: "s + e.what()); }
+    if (reparsed != root) fail("Round trip changed the parsed data: " + serialized);
+    if (serialize(reparsed, desc) != serialized) fail("Serialization is not stable: " + serialized);
+}
+
+extern "C" int LLVMFuzzerInitialize(int*, char***)
+{
+    pugi::set_memory_management_functions(fuzz_dom_allocate, std::free);
+    return 0;
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t* data, std::size_t size)
+{
+    fuzz_schema(std::string(reinterpret_cast<const char*>(data), size), example_schema());
+    return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "xml_parser/field_values.hpp"
+#include "xml_parser/binary_codecs.hpp"
+#include "xml_parser/node_data.hpp"
+#include "xml_parser/metrics.hpp"
+#include "xml_parser/profiler.hpp"
+#include "xml_parser/mpmc_queue.hpp"
+#include "xml_parser/schema.hpp"
+#include "xml_parser/parser.hpp"
+#include "xml_parser/worker_pool.hpp"
+#include "xml_parser/batch.hpp"
+#include "xml_parser/shared_result.hpp"
+#include "xml_parser/snapshot.hpp"
+#include "xml_parser/cursor.hpp"
+#include "xml_parser/events.hpp"
+#include "xml_parser/json.hpp"
+#include "xml_parser/wire.hpp"
+#include "xml_parser/document_stream.hpp"
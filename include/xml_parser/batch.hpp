@@ -0,0 +1,56 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <string>
+#include <vector>
+#include "node_data.hpp"
+#include "parser.hpp"
+#include "worker_pool.hpp"
+
+struct BatchResult
+{
+    std::vector<NodeData> documents;
+    std::vector<std::exception_ptr> errors;
+};
+
+// Parses documents on the pool. With a node given, all documents are parsed
+// (and their results allocated) on that NUMA node; otherwise the batch is
+// spread over all nodes. A failed document leaves an empty NodeData and its
+// exception in errors at the same index.
+//
+// Consecutive small documents are grouped into tasks of about taskBytes of
+// input, each parsed whole with one Parser. A large document gets a task of
+// its own and its long NodeLists are split into subtasks that idle workers
+// steal, so one huge document does not leave the other cores idle.
+template<class NodeDescription>
+inline BatchResult parse_batch(WorkerPool& pool, const std::vector<std::string>& documents, NodeDescription desc, int node = WorkerPool::anyNode, std::size_t taskBytes = 64 * 1024)
+{
+    BatchResult result;
+    result.documents.resize(documents.size());
+    result.errors.resize(documents.size());
+
+    TaskGroup group;
+    std::size_t begin = 0;
+    while (begin < documents.size())
+    {
+        auto end = begin;
+        std::size_t bytes = 0;
+        do bytes += documents[end++].size();
+        while (end < documents.size() && bytes + documents[end].size() <= taskBytes);
+
+        group.add();
+        pool.submit([&, begin, end] {
+            Parser<NodeDescription> parser(desc);
+            for (auto i = begin; i < end; ++i)
+            {
+                try { result.documents[i] = parser.parse(documents[i]); }
+                catch (...) { result.errors[i] = std::current_exception(); }
+            }
+            group.done();
+        }, node);
+        begin = end;
+    }
+    pool.wait(group);
+    return result;
+}
@@ -0,0 +1,290 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "field_values.hpp"
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define XML_PARSER_SSSE3_KERNELS 1
+#endif
+
+// Base64 (RFC 4648, with or without padding) and hexadecimal codecs for
+// binary fields. Decoding skips ASCII whitespace, so line-wrapped content
+// is accepted. On x86 the bulk of the data goes through SSSE3 kernels
+// (16 characters per step) when the CPU supports them, the scalar loops
+// handle the rest: whitespace, padding and the tail.
+
+inline constexpr char base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+inline constexpr char hexDigits[] = "0123456789abcdef";
+
+// Value of each character: 0-63 for the alphabet, 64 for whitespace, 0xff
+// for anything else
+inline constexpr std::array<std::uint8_t, 256> base64Values = [] {
+    std::array<std::uint8_t, 256> values{};
+    for (auto& value : values) value = 0xff;
+    for (std::uint8_t i = 0; i < 64; ++i) values[static_cast<unsigned char>(base64Alphabet[i])] = i;
+    for (unsigned char c : {' ', '\t', '\n', '\r'}) values[c] = 64;
+    return values;
+}();
+// As base64Values for hexadecimal digits of either case
+inline constexpr std::array<std::uint8_t, 256> hexValues = [] {
+    std::array<std::uint8_t, 256> values{};
+    for (auto& value : values) value = 0xff;
+    for (std::uint8_t i = 0; i < 16; ++i)
+    {
+        values[static_cast<unsigned char>(hexDigits[i])] = i;
+        values[static_cast<unsigned char>(hexDigits[i] & ~0x20)] = i;
+    }
+    for (unsigned char c : {' ', '\t', '\n', '\r'}) values[c] = 64;
+    return values;
+}();
+
+#ifdef XML_PARSER_SSSE3_KERNELS
+inline bool use_ssse3()
+{
+    static const bool supported = __builtin_cpu_supports("ssse3");
+    return supported;
+}
+
+// 16 characters to 12 bytes (W. Muła's nibble lookup); stores 16 bytes.
+// False if any character is outside the alphabet.
+__attribute__((target("ssse3"))) inline bool decode_base64_block(const char* s, std::uint8_t* out)
+{
+    const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1a, 0x1b, 0x1b, 0x1b, 0x1a);
+    const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), nibble);
+    __m128i invalid = _mm_and_si128(_mm_shuffle_epi8(lutLo, _mm_and_si128(in, nibble)), _mm_shuffle_epi8(lutHi, hiNibbles));
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) != 0xffff) return false;
+    __m128i roll = _mm_shuffle_epi8(lutRoll, _mm_add_epi8(_mm_cmpeq_epi8(in, _mm_set1_epi8('/')), hiNibbles));
+    in = _mm_add_epi8(in, roll);
+    // Merge four 6-bit values per 32-bit lane into 24 bits, then drop the
+    // high byte of every lane
+    in = _mm_maddubs_epi16(in, _mm_set1_epi32(0x01400140));
+    in = _mm_madd_epi16(in, _mm_set1_epi32(0x00011000));
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), in);
+    return true;
+}
+// 12 bytes (of 16 readable) to 16 characters
+__attribute__((target("ssse3"))) inline void encode_base64_block(const std::uint8_t* in, char* out)
+{
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    v = _mm_shuffle_epi8(v, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+    __m128i high = _mm_mulhi_epu16(_mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    __m128i low = _mm_mullo_epi16(_mm_and_si128(v, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(high, low);
+    // Offset from index to character, selected by the range of the index
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices));
+}
+// 16 hexadecimal digits to 8 bytes
+__attribute__((target("ssse3"))) inline bool decode_hex_block(const char* s, std::uint8_t* out)
+{
+    __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s));
+    __m128i digits = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+    __m128i letters = _mm_sub_epi8(_mm_or_si128(in, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    __m128i isDigit = _mm_cmpeq_epi8(_mm_min_epu8(digits, _mm_set1_epi8(9)), digits);
+    __m128i isLetter = _mm_cmpeq_epi8(_mm_min_epu8(letters, _mm_set1_epi8(5)), letters);
+    if (_mm_movemask_epi8(_mm_or_si128(isDigit, isLetter)) != 0xffff) return false;
+    __m128i values = _mm_or_si128(_mm_and_si128(isDigit, digits), _mm_and_si128(isLetter, _mm_add_epi8(letters, _mm_set1_epi8(10))));
+    __m128i pairs = _mm_maddubs_epi16(values, _mm_set1_epi16(0x0110));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(pairs, pairs));
+    return true;
+}
+// 16 bytes to 32 hexadecimal digits
+__attribute__((target("ssse3"))) inline void encode_hex_block(const std::uint8_t* in, char* out)
+{
+    const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hexDigits));
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    __m128i high = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+    __m128i low = _mm_shuffle_epi8(digits, _mm_and_si128(v, nibble));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(high, low));
+}
+#endif
+
+inline bool decode_base64(std::string_view text, Bytes& bytes)
+{
+    // Slack for the 16-byte stores of the block kernel
+    bytes.resize(text.size() / 4 * 3 + 16);
+    auto* out = bytes.data();
+    const char* s = text.data();
+    const char* end = s + text.size();
+    std::uint32_t bits = 0;
+    unsigned count = 0;
+#ifdef XML_PARSER_SSSE3_KERNELS
+    bool vectorized = use_ssse3();
+#endif
+    while (s != end)
+    {
+#ifdef XML_PARSER_SSSE3_KERNELS
+        // Blocks start on a quantum boundary; one holding whitespace or
+        // padding fails and is read by the scalar loop instead
+        if (vectorized && !count && end - s >= 16 && decode_base64_block(s, out))
+        {
+            s += 16;
+            out += 12;
+            continue;
+        }
+#endif
+        auto value = base64Values[static_cast<unsigned char>(*s)];
+        if (value == 64) { ++s; continue; }
+        if (value > 64) break;
+        ++s;
+        bits = bits << 6 | value;
+        if (++count == 4)
+        {
+            *out++ = static_cast<std::uint8_t>(bits >> 16);
+            *out++ = static_cast<std::uint8_t>(bits >> 8);
+            *out++ = static_cast<std::uint8_t>(bits);
+            bits = 0;
+            count = 0;
+        }
+    }
+    // At most two padding characters, then only whitespace
+    unsigned padding = 0;
+    for (; s != end; ++s)
+    {
+        if (*s == '=' && ++padding <= 2) continue;
+        if (base64Values[static_cast<unsigned char>(*s)] != 64) return false;
+    }
+    if (count == 1 || (padding && count + padding != 4)) return false;
+    if (count == 2) *out++ = static_cast<std::uint8_t>(bits >> 4);
+    if (count == 3)
+    {
+        *out++ = static_cast<std::uint8_t>(bits >> 10);
+        *out++ = static_cast<std::uint8_t>(bits >> 2);
+    }
+    bytes.resize(static_cast<std::size_t>(out - bytes.data()));
+    return true;
+}
+// The check of decode_base64 without decoding, usable at compile time
+// (for Defaults)
+inline constexpr bool base64_valid(std::string_view text)
+{
+    std::size_t pos = 0;
+    unsigned count = 0;
+    for (; pos < text.size(); ++pos)
+    {
+        auto value = base64Values[static_cast<unsigned char>(text[pos])];
+        if (value == 64) continue;
+        if (value > 64) break;
+        count = (count + 1) % 4;
+    }
+    unsigned padding = 0;
+    for (; pos < text.size(); ++pos)
+    {
+        if (text[pos] == '=' && ++padding <= 2) continue;
+        if (base64Values[static_cast<unsigned char>(text[pos])] != 64) return false;
+    }
+    return count != 1 && (!padding || count + padding == 4);
+}
+inline std::string encode_base64(const Bytes& bytes)
+{
+    std::string text((bytes.size() + 2) / 3 * 4, '=');
+    const auto* in = bytes.data();
+    const auto* end = in + bytes.size();
+    char* out = text.data();
+#ifdef XML_PARSER_SSSE3_KERNELS
+    if (use_ssse3())
+    {
+        for (; end - in >= 16; in += 12, out += 16) encode_base64_block(in, out);
+    }
+#endif
+    for (; end - in >= 3; in += 3, out += 4)
+    {
+        std::uint32_t bits = std::uint32_t(in[0]) << 16 | std::uint32_t(in[1]) << 8 | in[2];
+        out[0] = base64Alphabet[bits >> 18];
+        out[1] = base64Alphabet[bits >> 12 & 63];
+        out[2] = base64Alphabet[bits >> 6 & 63];
+        out[3] = base64Alphabet[bits & 63];
+    }
+    if (end - in == 1)
+    {
+        out[0] = base64Alphabet[in[0] >> 2];
+        out[1] = base64Alphabet[(in[0] & 3) << 4];
+    }
+    else if (end - in == 2)
+    {
+        out[0] = base64Alphabet[in[0] >> 2];
+        out[1] = base64Alphabet[(in[0] & 3) << 4 | in[1] >> 4];
+        out[2] = base64Alphabet[(in[1] & 15) << 2];
+    }
+    return text;
+}
+
+inline bool decode_hex(std::string_view text, Bytes& bytes)
+{
+    bytes.resize(text.size() / 2);
+    auto* out = bytes.data();
+    const char* s = text.data();
+    const char* end = s + text.size();
+    unsigned high = 0;
+    bool half = false;
+#ifdef XML_PARSER_SSSE3_KERNELS
+    bool vectorized = use_ssse3();
+#endif
+    while (s != end)
+    {
+#ifdef XML_PARSER_SSSE3_KERNELS
+        if (vectorized && !half && end - s >= 16 && decode_hex_block(s, out))
+        {
+            s += 16;
+            out += 8;
+            continue;
+        }
+#endif
+        auto value = hexValues[static_cast<unsigned char>(*s++)];
+        if (value == 64) continue;
+        if (value > 64) return false;
+        if (half) *out++ = static_cast<std::uint8_t>(high << 4 | value);
+        else high = value;
+        half = !half;
+    }
+    if (half) return false;
+    bytes.resize(static_cast<std::size_t>(out - bytes.data()));
+    return true;
+}
+// The check of decode_hex without decoding, usable at compile time (for
+// Defaults)
+inline constexpr bool hex_valid(std::string_view text)
+{
+    bool half = false;
+    for (char c : text)
+    {
+        auto value = hexValues[static_cast<unsigned char>(c)];
+        if (value == 64) continue;
+        if (value > 64) return false;
+        half = !half;
+    }
+    return !half;
+}
+inline std::string encode_hex(const Bytes& bytes)
+{
+    std::string text(bytes.size() * 2, '\0');
+    const auto* in = bytes.data();
+    const auto* end = in + bytes.size();
+    char* out = text.data();
+#ifdef XML_PARSER_SSSE3_KERNELS
+    if (use_ssse3())
+    {
+        for (; end - in >= 16; in += 16, out += 32) encode_hex_block(in, out);
+    }
+#endif
+    for (; in != end; ++in, out += 2)
+    {
+        out[0] = hexDigits[*in >> 4];
+        out[1] = hexDigits[*in & 15];
+    }
+    return text;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <pugixml.hpp>
+#include "node_data.hpp"
+#include "parser.hpp"
+#include "schema.hpp"
+
+// Pull access to a document through its schema. The cursor stands on one
+// element at a time; entering an element checks it the way parse() would
+// (required attributes, texts and nodes, typed values), so everything read
+// through the cursor conforms to the schema. Attributes and texts are
+// returned as views of the parse buffer, valid until the next open() (a
+// text merged from fragments until the next text()), and moving the cursor
+// does not allocate. An element that is not entered is skipped without
+// being looked at.
+//
+//     PullCursor cursor(s, schema);
+//     auto key = cursor.attribute("key");
+//     if (cursor.enter("data")) do consume(cursor.text()); while (cursor.next());
+class PullCursor
+{
+public:
+    template<class NodeDescription>
+    inline PullCursor(std::string s, NodeDescription desc)
+    {
+        open(std::move(s), desc);
+    }
+
+    // Starts over on another document, reusing the buffer and pugixml
+    // document. Without a (not Required) root the cursor is empty().
+    template<class NodeDescription>
+    inline void open(std::string s, NodeDescription desc)
+    {
+        stack.clear();
+        buffer = std::move(s);
+        load_document_inplace(doc, buffer);
+        auto& schema = NodeDescription::schema();
+        stack.reserve(schema.depth);
+        auto root = doc.document_element();
+        if (!desc.validate(root)) return;
+        check(root, schema);
+        stack.push_back({root, &schema, false});
+    }
+
+    inline bool empty() const { return stack.empty(); }
+    inline std::size_t depth() const { return stack.size(); }
+    inline const char* name() const { return top().schema->name; }
+
+    // Value of an attribute of the schema, its Default or "" when absent
+    inline std::string_view attribute(std::string_view name) const
+    {
+        auto& frame = top();
+        for (auto& attribute : frame.schema->attributes)
+        {
+            if (name != attribute.name) continue;
+            if (auto attr = frame.node.attribute(attribute.name)) return attr.value();
+            return attribute.defaultValue ? attribute.defaultValue : "";
+        }
+        throw std::out_of_range("No attribute "s + std::string(name) + " in the schema of node " + frame.schema->name);
+    }
+    // The element's text, its Default or "" when absent. Only text made of
+    // several fragments is copied, into a buffer the cursor reuses.
+    inline std::string_view text()
+    {
+        auto& frame = top();
+        if (!frame.schema->text) throw std::out_of_range("No text in the schema of node "s + frame.schema->name);
+        const char* result = nullptr;
+        read_text(frame.node, [&](const char* text) { result = text; }, textBuffer);
+        if (!*result && frame.schema->textDefault) return frame.schema->textDefault;
+        return result;
+    }
+
+    // Moves to the first child element called child, which must be a Node
+    // or NodeList entry of the current element. False if there is none.
+    inline bool enter(std::string_view child)
+    {
+        auto& frame = top();
+        for (auto& candidate : frame.schema->children)
+        {
+            if (child != candidate.element->name) continue;
+            auto node = frame.node.child(candidate.element->name);
+            if (!node) return false;
+            check(node, *candidate.element);
+            stack.push_back({node, candidate.element, candidate.list});
+            return true;
+        }
+        throw std::out_of_range("No node "s + std::string(child) + " in the schema of node " + frame.schema->name);
+    }
+    // Moves to the next entry of the NodeList being iterated. At its end
+    // (and on a single Node) returns to the parent and returns false.
+    inline bool next()
+    {
+        auto& frame = top();
+        if (frame.list)
+        {
+            if (auto node = frame.node.next_sibling(frame.schema->name))
+            {
+                check(node, *frame.schema);
+                frame.node = node;
+                return true;
+            }
+        }
+        stack.pop_back();
+        return false;
+    }
+    // Returns to the parent, skipping the rest of the element
+    inline void leave()
+    {
+        top();
+        stack.pop_back();
+    }
+
+private:
+    struct Frame
+    {
+        pugi::xml_node node;
+        const SchemaElement* schema;
+        bool list;
+    };
+
+    inline const Frame& top() const
+    {
+        if (stack.empty()) throw std::logic_error("The cursor is not on an element");
+        return stack.back();
+    }
+    inline Frame& top()
+    {
+        if (stack.empty()) throw std::logic_error("The cursor is not on an element");
+        return stack.back();
+    }
+
+    // The checks of the parse() of element's Node, without storing anything
+    inline void check(pugi::xml_node node, const SchemaElement& element)
+    {
+        for (auto& attribute : element.attributes)
+        {
+            auto attr = node.attribute(attribute.name);
+            if (!attr)
+            {
+                if (attribute.required) throw ParseError(ParseError::Reason::MissingAttribute, "Expected xml attribute "s + attribute.name);
+            }
+            else if (attribute.check && !attribute.check(attr.value()))
+                throw ParseError(ParseError::Reason::InvalidValue, "Unexpected value "s + attr.value() + " of "s + attribute.name);
+        }
+        if (element.text)
+        {
+            if (node.text().empty())
+            {
+                if (element.textRequired) throw ParseError(ParseError::Reason::MissingText, "A text node is required");
+            }
+            else if (element.checkText)
+            {
+                read_text(node, [&](const char* text) {
+                    if (!element.checkText(text))
+                        throw ParseError(ParseError::Reason::InvalidValue, "Unexpected value "s + text + " of #text");
+                }, checkBuffer);
+            }
+        }
+        for (auto& child : element.children)
+        {
+            if (!child.list && child.element->required && !node.child(child.element->name))
+                throw ParseError(ParseError::Reason::MissingNode, "Expected an xml node of name "s + child.element->name);
+        }
+    }
+
+    pugi::xml_document doc;
+    std::string buffer;
+    std::string textBuffer;
+    std::string checkBuffer;
+    std::vector<Frame> stack;
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "node_data.hpp"
+#include "parser.hpp"
+
+// Cuts a byte stream into records: the elements that start at recordDepth,
+// i.e. back-to-back documents with 0 and the children of a root that may
+// never be closed with 1. Bytes arrive in pieces of any size; the splitter
+// only tracks the markup (tags with quoted attribute values, comments,
+// CDATA sections, processing instructions and declarations) needed to
+// find where each record ends, pugixml checks the rest when the record is
+// parsed. Anything outside records, such as an XML declaration or the
+// root's own tags, is dropped; so are namespace declarations of the root,
+// which a record therefore cannot rely on.
+class DocumentSplitter
+{
+public:
+    inline explicit DocumentSplitter(std::size_t recordDepth = 0)
+        : recordDepth(recordDepth)
+    { }
+
+    // Appends bytes and calls record(text) for every record completed by
+    // them; text is only valid during the call. An exception from record
+    // leaves the splitter after that record, so feeding can go on.
+    template<class Record>
+    inline void feed(std::string_view bytes, Record&& record)
+    {
+        compact();
+        buffer.append(bytes);
+        scan(record);
+    }
+    // Checks that the stream did not end inside a record or markup. Only
+    // the elements enclosing the records may stay open.
+    inline void finish() const
+    {
+        if (state != State::Text || recordStart != std::string::npos)
+            throw ParseError(ParseError::Reason::MalformedXml, "Malformed xml: stream ended inside a record");
+    }
+
+private:
+    enum class State { Text, Markup, StartTag, EndTag, Comment, CData, Instruction, Declaration };
+
+    template<class Record>
+    inline void scan(Record& record)
+    {
+        std::string_view view(buffer);
+        while (pos < view.size())
+        {
+            switch (state)
+            {
+            case State::Text:
+            {
+                auto* found = static_cast<const char*>(std::memchr(view.data() + pos, '<', view.size() - pos));
+                auto end = found ? static_cast<std::size_t>(found - view.data()) : view.size();
+                if (!depth && view.find_first_not_of(" \t\r\n", pos) < end)
+                    throw ParseError(ParseError::Reason::MalformedXml, "Malformed xml: text outside of a document");
+                pos = end;
+                if (found)
+                {
+                    markupStart = pos;
+                    state = State::Markup;
+                }
+                break;
+            }
+            case State::Markup:
+            {
+                auto markup = view.substr(markupStart);
+                if (markup.size() < 2) return;
+                if (markup[1] == '?') open(State::Instruction, 2);
+                else if (markup[1] == '/') open(State::EndTag, 2);
+                else if (markup[1] != '!') open(State::StartTag, 1);
+                else if (markup.substr(0, 4) == "<!--") open(State::Comment, 4);
+                else if (markup.substr(0, 9) == "<![CDATA[") open(State::CData, 9);
+                // Wait for the bytes telling these apart from a declaration
+                else if ((markup.size() < 4 && std::string_view("<!--").substr(0, markup.size()) == markup)
+                         || (markup.size() < 9 && std::string_view("<![CDATA[").substr(0, markup.size()) == markup))
+                    return;
+                else open(State::Declaration, 2);
+                break;
+            }
+            case State::Comment: if (!skip_to(view, "-->")) return; break;
+            case State::CData: if (!skip_to(view, "]]>")) return; break;
+            case State::Instruction: if (!skip_to(view, "?>")) return; break;
+            case State::Declaration:
+                // A DOCTYPE's internal subset may hold '>' in brackets
+                for (; pos < view.size() && state == State::Declaration; ++pos)
+                {
+                    char c = view[pos];
+                    if (quote) quote = c == quote ? 0 : quote;
+                    else if (c == '"' || c == '\'') quote = c;
+                    else if (c == '[') ++brackets;
+                    else if (c == ']' && brackets) --brackets;
+                    else if (c == '>' && !brackets) state = State::Text;
+                }
+                break;
+            case State::StartTag:
+                for (; pos < view.size() && state == State::StartTag; ++pos)
+                {
+                    char c = view[pos];
+                    if (quote) quote = c == quote ? 0 : quote;
+                    else if (c == '"' || c == '\'') quote = c;
+                    else if (c == '>') start_tag(view, record);
+                }
+                break;
+            case State::EndTag:
+            {
+                auto end = view.find('>', pos);
+                if (end == std::string_view::npos)
+                {
+                    pos = view.size();
+                    return;
+                }
+                pos = end + 1;
+                state = State::Text;
+                if (!depth) throw ParseError(ParseError::Reason::MalformedXml, "Malformed xml: end tag outside of a document");
+                if (--depth == recordDepth && recordStart != std::string::npos) emit(view, record);
+                break;
+            }
+            }
+        }
+    }
+    inline void open(State markup, std::size_t length)
+    {
+        state = markup;
+        pos = markupStart + length;
+        quote = 0;
+        brackets = 0;
+    }
+    // Moves past terminator, or as far as a terminator split between
+    // this piece and the next one allows
+    inline bool skip_to(std::string_view view, std::string_view terminator)
+    {
+        auto end = view.find(terminator, pos);
+        if (end == std::string_view::npos)
+        {
+            pos = std::max(pos, view.size() - std::min(view.size(), terminator.size() - 1));
+            return false;
+        }
+        pos = end + terminator.size();
+        state = State::Text;
+        return true;
+    }
+    // At the '>' of a start tag (pos is still on it)
+    template<class Record>
+    inline void start_tag(std::string_view view, Record& record)
+    {
+        state = State::Text;
+        if (depth == recordDepth) recordStart = markupStart;
+        if (view[pos - 1] != '/') ++depth;
+        else if (depth == recordDepth)
+        {
+            ++pos;
+            emit(view, record);
+            --pos;
+        }
+    }
+    template<class Record>
+    inline void emit(std::string_view view, Record& record)
+    {
+        auto start = std::exchange(recordStart, std::string::npos);
+        record(view.substr(start, pos - start));
+    }
+    // Drops the bytes no longer needed, once they are most of the buffer
+    inline void compact()
+    {
+        auto keep = recordStart != std::string::npos ? recordStart : state == State::Text ? pos : markupStart;
+        if (keep < buffer.size() / 2 || !keep) return;
+        buffer.erase(0, keep);
+        pos -= keep;
+        markupStart -= std::min(markupStart, keep);
+        if (recordStart != std::string::npos) recordStart -= keep;
+    }
+
+    std::size_t recordDepth;
+    std::string buffer;
+    State state = State::Text;
+    std::size_t pos = 0;
+    std::size_t markupStart = 0;
+    std::size_t recordStart = std::string::npos;
+    std::size_t depth = 0;
+    char quote = 0;
+    std::size_t brackets = 0;
+};
+
+// Parses every record of in with desc, the description of a record, and
+// passes each NodeData to sink as soon as the record is complete. Each
+// read takes what in has buffered, up to chunkSize bytes, and waits for a
+// single byte only when nothing is, so records of a slow pipe or socket
+// are not held back and the stream may be endless. A record
+// that does not parse is passed to skipped(error, text) instead, text
+// only valid during the call, and the stream goes on with the next one;
+// markup that leaves the records themselves unclear (text or end tags
+// outside of them, a stream ending inside one) still ends the stream
+// with a ParseError. Returns the number of records passed to sink.
+template<class NodeDescription, class Sink, class Skipped>
+inline std::size_t parse_document_stream_skipping(std::istream& in, NodeDescription desc, Sink&& sink, Skipped&& skipped, std::size_t recordDepth = 0, std::size_t chunkSize = 64 * 1024)
+{
+    DocumentSplitter splitter(recordDepth);
+    Parser<NodeDescription> parser(desc);
+    std::string chunk(std::max<std::size_t>(chunkSize, 1), '\0');
+    std::size_t records = 0;
+    auto record = [&](std::string_view text) {
+        NodeData data;
+        try
+        {
+            data = parser.parse(text);
+        }
+        catch (const ParseError& e)
+        {
+            skipped(e, text);
+            return;
+        }
+        sink(std::move(data));
+        ++records;
+    };
+    auto read_available = [&]() -> std::size_t {
+        std::streamsize size = 0;
+        if (in.rdbuf()->in_avail() <= 0)
+        {
+            if (!in.read(chunk.data(), 1)) return 0;
+            size = 1;
+        }
+        size += in.readsome(chunk.data() + size, static_cast<std::streamsize>(chunk.size()) - size);
+        return static_cast<std::size_t>(size);
+    };
+    while (auto size = read_available())
+        splitter.feed(std::string_view(chunk.data(), size), record);
+    splitter.finish();
+    return records;
+}
+// The same, but the first record that does not parse ends the stream with
+// its ParseError
+template<class NodeDescription, class Sink>
+inline std::size_t parse_document_stream(std::istream& in, NodeDescription desc, Sink&& sink, std::size_t recordDepth = 0, std::size_t chunkSize = 64 * 1024)
+{
+    return parse_document_stream_skipping(in, desc, std::forward<Sink>(sink), [](const ParseError&, std::string_view) { throw; }, recordDepth, chunkSize);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <pugixml.hpp>
+#include "parser.hpp"
+#include "schema.hpp"
+
+// Walks a document through its schema and reports it to handler as events,
+// without building a NodeData:
+//
+//     handler.start_record(id, name)   // a Node or NodeList entry begins
+//     handler.field(id, value)         // one of its attributes or its text
+//     handler.end_record(id)           // after its fields and sub records
+//
+// Ids are std::integral_constant<std::size_t, ...>, so a handler may take
+// them as std::size_t or dispatch on them at compile time. Records and
+// fields are numbered separately, depth first in declaration order; the
+// schema type's record_id("root/data") and field_id("root/data/@id") give
+// them by path and fieldCount / recordCount the number of each. A value is
+// a std::string_view, or for a field type an Enum's index (std::uint8_t), a
+// Timestamp, a Decimal or const Bytes&; views and references are only
+// valid during the call. Absent fields have no event. Checks and errors
+// are the ones of parse(); an error may come after events of the document.
+template<class NodeDescription, class Handler>
+inline void emit_events(const std::string& s, NodeDescription desc, Handler& handler)
+{
+    pugi::xml_document doc;
+    load_document(doc, s);
+    auto root = doc.document_element();
+    if (desc.validate(root)) desc.template emit<0, 0>(handler, root);
+}
@@ -0,0 +1,337 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Point in time, normalized to UTC
+struct Timestamp
+{
+    std::int64_t seconds;       // since 1970-01-01T00:00:00Z
+    std::uint32_t nanoseconds;
+};
+inline bool operator==(const Timestamp& a, const Timestamp& b)
+{
+    return a.seconds == b.seconds && a.nanoseconds == b.nanoseconds;
+}
+inline bool operator!=(const Timestamp& a, const Timestamp& b)
+{
+    return !(a == b);
+}
+
+// Fixed-point number: units / 10^scale
+struct Decimal
+{
+    std::int64_t units;
+    std::uint8_t scale;
+};
+inline bool operator==(const Decimal& a, const Decimal& b)
+{
+    return a.units == b.units && a.scale == b.scale;
+}
+inline bool operator!=(const Decimal& a, const Decimal& b)
+{
+    return !(a == b);
+}
+
+// Decoded content of a binary field
+using Bytes = std::vector<std::uint8_t>;
+
+// Digits and separators are checked eight bytes at a time: a byte is a
+// digit iff its high nibble is 3 and adding 6 does not carry out of its low
+// nibble. mask selects the digit bytes, the other bytes must equal pattern.
+inline std::uint64_t load_word(const char* s)
+{
+    std::uint64_t word;
+    std::memcpy(&word, s, sizeof(word));
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    word = __builtin_bswap64(word);
+#endif
+    return word;
+}
+inline bool match_word(std::uint64_t word, std::uint64_t mask, std::uint64_t pattern)
+{
+    auto high = mask & 0xf0f0f0f0f0f0f0f0ull;
+    auto digits = mask & 0x3030303030303030ull;
+    return !((word & high) ^ digits) && !(((word + (mask & 0x0606060606060606ull)) & high) ^ digits)
+        && !((word ^ pattern) & ~mask);
+}
+// Value of eight digits (already checked) in three multiplications
+inline std::uint32_t eight_digits(std::uint64_t word)
+{
+    word = (word & 0x0f0f0f0f0f0f0f0full) * 2561 >> 8;
+    word = (word & 0x00ff00ff00ff00ffull) * 6553601 >> 16;
+    return static_cast<std::uint32_t>((word & 0x0000ffff0000ffffull) * 42949672960001ull >> 32);
+}
+inline unsigned digit_pair(const char* s)
+{
+    return static_cast<unsigned>(s[0] - '0') * 10 + static_cast<unsigned>(s[1] - '0');
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date and back
+// (H. Hinnant's algorithms, without branches on the month).
+inline constexpr std::int64_t days_from_civil(std::int64_t year, unsigned month, unsigned day)
+{
+    year -= month <= 2;
+    auto era = (year >= 0 ? year : year - 399) / 400;
+    auto yearOfEra = static_cast<unsigned>(year - era * 400);
+    auto dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    auto dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + static_cast<std::int64_t>(dayOfEra) - 719468;
+}
+inline constexpr void civil_from_days(std::int64_t days, std::int64_t& year, unsigned& month, unsigned& day)
+{
+    days += 719468;
+    auto era = (days >= 0 ? days : days - 146096) / 146097;
+    auto dayOfEra = static_cast<unsigned>(days - era * 146097);
+    auto yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    auto dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    auto shiftedMonth = (5 * dayOfYear + 2) / 153;
+    day = dayOfYear - (153 * shiftedMonth + 2) / 5 + 1;
+    month = shiftedMonth < 10 ? shiftedMonth + 3 : shiftedMonth - 9;
+    year = static_cast<std::int64_t>(yearOfEra) + era * 400 + (month <= 2);
+}
+
+// Timestamps of years 0000 to 9999 in UTC, the range the text form covers
+inline constexpr std::int64_t timestampMin = days_from_civil(0, 1, 1) * 86400;
+inline constexpr std::int64_t timestampMax = days_from_civil(10000, 1, 1) * 86400 - 1;
+
+// Parses an ISO 8601 / RFC 3339 date-time: YYYY-MM-DDTHH:MM:SS, an optional
+// fraction of up to nine digits, then Z or +HH:MM / -HH:MM.
+inline bool parse_timestamp(std::string_view text, Timestamp& result)
+{
+    if (text.size() < 20) return false;
+    char head[16];
+    std::memcpy(head, text.data(), sizeof(head));
+    if (head[10] == 't' || head[10] == ' ') head[10] = 'T';
+    // "YYYY-MM-" and "DDTHH:MM"
+    if (!match_word(load_word(head), 0xffff00ffffffffull, 0x2d00002d00000000ull)
+        || !match_word(load_word(head + 8), 0xffff00ffff00ffffull, 0x00003a0000540000ull))
+        return false;
+    const char* s = text.data();
+    if (s[16] != ':' || unsigned(s[17] - '0') > 9 || unsigned(s[18] - '0') > 9) return false;
+
+    auto year = digit_pair(s) * 100 + digit_pair(s + 2);
+    auto month = digit_pair(s + 5), day = digit_pair(s + 8);
+    auto hour = digit_pair(s + 11), minute = digit_pair(s + 14), second = digit_pair(s + 17);
+    static constexpr unsigned char monthDays[] = {0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    if (month - 1 > 11 || day - 1 >= static_cast<unsigned>(monthDays[month] - (month == 2 && !leap)) || hour > 23 || minute > 59 || second > 59)
+        return false;
+
+    std::size_t pos = 19;
+    std::uint32_t nanoseconds = 0;
+    if (s[pos] == '.')
+    {
+        auto begin = ++pos;
+        while (pos < text.size() && unsigned(s[pos] - '0') <= 9 && pos - begin < 9)
+            nanoseconds = nanoseconds * 10 + static_cast<std::uint32_t>(s[pos++] - '0');
+        if (pos == begin) return false;
+        static constexpr std::uint32_t scale[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000};
+        nanoseconds *= scale[9 - (pos - begin)];
+    }
+    std::int64_t offset = 0;
+    if (pos + 1 == text.size() && (s[pos] == 'Z' || s[pos] == 'z'))
+    { }
+    else if (pos + 6 == text.size() && (s[pos] == '+' || s[pos] == '-') && s[pos + 3] == ':'
+             && unsigned(s[pos + 1] - '0') <= 9 && unsigned(s[pos + 2] - '0') <= 9
+             && unsigned(s[pos + 4] - '0') <= 9 && unsigned(s[pos + 5] - '0') <= 9)
+    {
+        auto offsetHour = digit_pair(s + pos + 1), offsetMinute = digit_pair(s + pos + 4);
+        if (offsetHour > 23 || offsetMinute > 59) return false;
+        offset = (s[pos] == '-' ? -60 : 60) * static_cast<std::int64_t>(offsetHour * 60 + offsetMinute);
+    }
+    else return false;
+
+    auto seconds = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+    if (seconds < timestampMin || seconds > timestampMax) return false;
+    result = {seconds, nanoseconds};
+    return true;
+}
+// The check of parse_timestamp one character at a time, usable at compile
+// time (for Defaults)
+inline constexpr bool timestamp_valid(std::string_view text)
+{
+    if (text.size() < 20) return false;
+    auto digit = [&](std::size_t i) { return i < text.size() && unsigned(text[i] - '0') <= 9; };
+    auto pair = [&](std::size_t i) { return unsigned(text[i] - '0') * 10 + unsigned(text[i + 1] - '0'); };
+    for (std::size_t i : {0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, 17, 18})
+        if (!digit(i)) return false;
+    if (text[4] != '-' || text[7] != '-' || (text[10] != 'T' && text[10] != 't' && text[10] != ' ') || text[13] != ':' || text[16] != ':')
+        return false;
+
+    auto year = pair(0) * 100 + pair(2);
+    auto month = pair(5), day = pair(8), hour = pair(11), minute = pair(14), second = pair(17);
+    const unsigned char monthDays[] = {0, 31, 29, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+    bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    if (month - 1 > 11 || day - 1 >= static_cast<unsigned>(monthDays[month] - (month == 2 && !leap)) || hour > 23 || minute > 59 || second > 59)
+        return false;
+
+    std::size_t pos = 19;
+    if (text[pos] == '.')
+    {
+        auto begin = ++pos;
+        while (digit(pos) && pos - begin < 9) ++pos;
+        if (pos == begin) return false;
+    }
+    std::int64_t offset = 0;
+    if (pos + 1 == text.size() && (text[pos] == 'Z' || text[pos] == 'z'))
+    { }
+    else if (pos + 6 == text.size() && (text[pos] == '+' || text[pos] == '-') && text[pos + 3] == ':'
+             && digit(pos + 1) && digit(pos + 2) && digit(pos + 4) && digit(pos + 5))
+    {
+        auto offsetHour = pair(pos + 1), offsetMinute = pair(pos + 4);
+        if (offsetHour > 23 || offsetMinute > 59) return false;
+        offset = (text[pos] == '-' ? -60 : 60) * static_cast<std::int64_t>(offsetHour * 60 + offsetMinute);
+    }
+    else return false;
+
+    auto seconds = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset;
+    return seconds >= timestampMin && seconds <= timestampMax;
+}
+// Formats as YYYY-MM-DDTHH:MM:SS[.fraction]Z with trailing zeros of the
+// fraction removed, which parse_timestamp reads back exactly.
+inline std::string format_timestamp(const Timestamp& value)
+{
+    auto days = value.seconds / 86400 - (value.seconds % 86400 < 0);
+    auto second = static_cast<unsigned>(value.seconds - days * 86400);
+    std::int64_t year;
+    unsigned month, day;
+    civil_from_days(days, year, month, day);
+
+    char buffer[32];
+    auto put = [&](char* p, unsigned n) { p[0] = static_cast<char>('0' + n / 10); p[1] = static_cast<char>('0' + n % 10); };
+    put(buffer, static_cast<unsigned>(year / 100));
+    put(buffer + 2, static_cast<unsigned>(year % 100));
+    std::memcpy(buffer + 4, "-MM-DDTHH:MM:SS", 15);
+    put(buffer + 5, month);
+    put(buffer + 8, day);
+    put(buffer + 11, second / 3600);
+    put(buffer + 14, second / 60 % 60);
+    put(buffer + 17, second % 60);
+    std::size_t size = 19;
+    if (auto fraction = value.nanoseconds)
+    {
+        buffer[size++] = '.';
+        for (std::uint32_t unit = 100000000; fraction; unit /= 10)
+        {
+            buffer[size++] = static_cast<char>('0' + fraction / unit);
+            fraction %= unit;
+        }
+    }
+    buffer[size++] = 'Z';
+    return std::string(buffer, size);
+}
+
+// Parses [+-]digits[.digits] into units of 10^-scale. More fraction digits
+// than scale are accepted only if they are zeros, so the value is exact.
+inline bool parse_decimal(std::string_view text, unsigned scale, Decimal& result)
+{
+    const char* s = text.data();
+    const char* end = s + text.size();
+    bool negative = s != end && *s == '-';
+    if (s != end && (*s == '-' || *s == '+')) ++s;
+
+    // Accumulate all digits as one unsigned integer, eight at a time where
+    // possible, then scale by the missing fraction digits.
+    std::uint64_t units = 0;
+    std::size_t digits = 0, fractionDigits = 0;
+    bool overflow = false, point = false;
+    while (s != end)
+    {
+        if (end - s >= 8)
+        {
+            auto word = load_word(s);
+            if (match_word(word, ~0ull, 0) && (!point || fractionDigits + 8 <= scale))
+            {
+                overflow |= units > (std::numeric_limits<std::uint64_t>::max() - 99999999) / 100000000;
+                units = units * 100000000 + eight_digits(word);
+                digits += 8;
+                if (point) fractionDigits += 8;
+                s += 8;
+                continue;
+            }
+        }
+        if (*s == '.' && !point)
+        {
+            point = true;
+            ++s;
+            continue;
+        }
+        auto digit = static_cast<unsigned>(*s - '0');
+        if (digit > 9) return false;
+        ++s;
+        ++digits;
+        if (point && fractionDigits == scale)
+        {
+            if (digit) return false;
+            continue;
+        }
+        overflow |= units > (std::numeric_limits<std::uint64_t>::max() - digit) / 10;
+        units = units * 10 + digit;
+        if (point) ++fractionDigits;
+    }
+    if (!digits) return false;
+    for (; fractionDigits < scale; ++fractionDigits)
+    {
+        overflow |= units > std::numeric_limits<std::uint64_t>::max() / 10;
+        units *= 10;
+    }
+    auto limit = static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) + negative;
+    if (overflow || units > limit) return false;
+    result = {negative ? static_cast<std::int64_t>(0 - units) : static_cast<std::int64_t>(units), static_cast<std::uint8_t>(scale)};
+    return true;
+}
+// The check of parse_decimal one character at a time, usable at compile
+// time (for Defaults)
+inline constexpr bool decimal_valid(std::string_view text, unsigned scale)
+{
+    std::size_t pos = 0;
+    bool negative = !text.empty() && text[0] == '-';
+    if (!text.empty() && (text[0] == '-' || text[0] == '+')) ++pos;
+    std::uint64_t units = 0;
+    std::size_t digits = 0, fractionDigits = 0;
+    bool overflow = false, point = false;
+    for (; pos < text.size(); ++pos)
+    {
+        if (text[pos] == '.' && !point)
+        {
+            point = true;
+            continue;
+        }
+        auto digit = static_cast<unsigned>(text[pos] - '0');
+        if (digit > 9) return false;
+        ++digits;
+        if (point && fractionDigits == scale)
+        {
+            if (digit) return false;
+            continue;
+        }
+        overflow |= units > (std::numeric_limits<std::uint64_t>::max() - digit) / 10;
+        units = units * 10 + digit;
+        if (point) ++fractionDigits;
+    }
+    if (!digits) return false;
+    for (; fractionDigits < scale; ++fractionDigits)
+    {
+        overflow |= units > std::numeric_limits<std::uint64_t>::max() / 10;
+        units *= 10;
+    }
+    return !overflow && units <= static_cast<std::uint64_t>(std::numeric_limits<std::int64_t>::max()) + negative;
+}
+// Formats with exactly scale fraction digits
+inline std::string format_decimal(const Decimal& value)
+{
+    char buffer[48];
+    char* end = buffer + sizeof(buffer);
+    char* p = end;
+    auto units = value.units < 0 ? 0 - static_cast<std::uint64_t>(value.units) : static_cast<std::uint64_t>(value.units);
+    for (unsigned i = 0; i < value.scale; ++i, units /= 10) *--p = static_cast<char>('0' + units % 10);
+    if (value.scale) *--p = '.';
+    do *--p = static_cast<char>('0' + units % 10); while (units /= 10);
+    if (value.units < 0) *--p = '-';
+    return std::string(p, end);
+}
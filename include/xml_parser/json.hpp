@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <pugixml.hpp>
+#include "json_reader.hpp"
+#include "node_data.hpp"
+#include "parser.hpp"
+#include "schema.hpp"
+
+// JSON form of a document, driven by its schema (members as described at
+// append_json_key). The root is the top level object, without its name.
+
+// Transcodes xml to JSON directly from the pugixml tree, without a
+// NodeData; the checks and errors are the ones of parse(). The result is
+// the one serialize_json() gives for parse(s, desc). out is overwritten,
+// so its capacity is reused between calls.
+template<class NodeDescription>
+inline void xml_to_json(const std::string& s, NodeDescription desc, std::string& out)
+{
+    pugi::xml_document doc;
+    load_document(doc, s);
+    auto root = doc.document_element();
+    out.clear();
+    out.reserve(s.size());
+    desc.validate(root);
+    desc.transcode_json_object(out, root);
+}
+template<class NodeDescription>
+inline std::string xml_to_json(const std::string& s, NodeDescription desc)
+{
+    std::string out;
+    xml_to_json(s, desc, out);
+    return out;
+}
+
+template<class NodeDescription>
+inline std::string serialize_json(const NodeData& data, NodeDescription desc)
+{
+    std::string out;
+    desc.serialize_json_object(out, data);
+    return out;
+}
+
+// Reads the JSON form into the NodeData parse() gives for the equivalent
+// xml, with the same checks. Members the schema does not know are skipped;
+// a null value is an absent field. Malformed JSON is a ParseError with
+// the MalformedJson reason.
+template<class NodeDescription>
+inline NodeData parse_json(std::string_view s, NodeDescription desc)
+{
+    return parse_measured<NodeDescription>(s.size(), [&] {
+        JsonReader reader(s);
+        NodeData data;
+        desc.parse_json_object(reader, data);
+        reader.finish();
+        return data;
+    });
+}
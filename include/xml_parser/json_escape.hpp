@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include "field_values.hpp"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Writing JSON strings. Runs of characters that need no escape (everything
+// but '"', '\\' and control characters) are found 16 bytes at a time with
+// SSE2, which every x86-64 CPU has, or 8 at a time with SWAR elsewhere, and
+// appended with one copy; only the characters to escape go through a table.
+
+// Escape of each byte: 0 if none, else the character after '\\' ('u' for
+// \u00XX)
+inline constexpr std::array<char, 256> jsonEscapes = [] {
+    std::array<char, 256> escapes{};
+    for (unsigned c = 0; c < 0x20; ++c) escapes[c] = 'u';
+    escapes['\b'] = 'b';
+    escapes['\f'] = 'f';
+    escapes['\n'] = 'n';
+    escapes['\r'] = 'r';
+    escapes['\t'] = 't';
+    escapes['"'] = '"';
+    escapes['\\'] = '\\';
+    return escapes;
+}();
+
+// Length of the prefix of [s, end) that needs no escape
+inline std::size_t json_clean_prefix(const char* s, const char* end)
+{
+    const char* p = s;
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    for (; end - p >= 16; p += 16)
+    {
+        __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        // Unsigned in <= 0x1f iff max(in, 0x1f) == 0x1f
+        __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(in, quote), _mm_cmpeq_epi8(in, backslash)),
+                                       _mm_cmpeq_epi8(_mm_max_epu8(in, control), control));
+        if (auto mask = _mm_movemask_epi8(special)) return static_cast<std::size_t>(p - s) + static_cast<unsigned>(__builtin_ctz(static_cast<unsigned>(mask)));
+    }
+#else
+    // A byte is zero in word ^ broadcast(c) iff it equals c; the test for
+    // zero and for < 0x20 bytes may flag bytes after a real hit, never
+    // before one, so a flagged word is finished by the scalar loop.
+    constexpr std::uint64_t ones = 0x0101010101010101ull, highs = 0x8080808080808080ull;
+    auto has_less = [](std::uint64_t word, std::uint64_t n) { return (word - ones * n) & ~word & highs; };
+    for (; end - p >= 8; p += 8)
+    {
+        auto word = load_word(p);
+        if (has_less(word, 0x20) | has_less(word ^ (ones * '"'), 1) | has_less(word ^ (ones * '\\'), 1)) break;
+    }
+#endif
+    while (p != end && !jsonEscapes[static_cast<unsigned char>(*p)]) ++p;
+    return static_cast<std::size_t>(p - s);
+}
+
+// Appends text as a quoted JSON string
+inline void append_json_string(std::string& out, std::string_view text)
+{
+    const char* s = text.data();
+    const char* end = s + text.size();
+    out += '"';
+    for (;;)
+    {
+        auto clean = json_clean_prefix(s, end);
+        out.append(s, clean);
+        s += clean;
+        if (s == end) break;
+        auto c = static_cast<unsigned char>(*s++);
+        char escape[6] = {'\\', jsonEscapes[c], '0', '0', "0123456789abcdef"[c >> 4], "0123456789abcdef"[c & 15]};
+        out.append(escape, escape[1] == 'u' ? 6 : 2);
+    }
+    out += '"';
+}
+
+// Appends the separator needed before the next member or array entry
+inline void append_json_separator(std::string& out)
+{
+    if (out.back() != '{' && out.back() != '[') out += ',';
+}
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "binary_codecs.hpp"
+#include "json_escape.hpp"
+#include "node_data.hpp"
+
+// Pull reader over a JSON text for the schema driven parse_json(). Strings
+// without escapes, numbers and literals are returned as views of the input;
+// only strings with escapes are decoded, into a buffer the reader reuses.
+// Every error is a ParseError with the MalformedJson reason.
+class JsonReader
+{
+public:
+    // Nesting allowed in values the schema does not know and skips
+    static inline constexpr std::size_t maxSkipDepth = 512;
+
+    inline explicit JsonReader(std::string_view text)
+        : begin(text.data()), p(text.data()), end(text.data() + text.size())
+    { }
+
+    // Calls member(key) for every member of an object; member must read
+    // the value. The key is only valid until the value is read.
+    template<class Member>
+    inline void object(Member&& member)
+    {
+        expect('{');
+        if (consume('}')) return;
+        do
+        {
+            auto key = string(keyBuffer);
+            expect(':');
+            member(key);
+        }
+        while (consume(','));
+        expect('}');
+    }
+    // Calls entry() for every entry of an array; entry must read it.
+    template<class Entry>
+    inline void array(Entry&& entry)
+    {
+        expect('[');
+        if (consume(']')) return;
+        do entry(); while (consume(','));
+        expect(']');
+    }
+    // Reads a string, number, true or false as its text (a string without
+    // the quotes and unescaped); false for null.
+    inline bool scalar(std::string_view& value)
+    {
+        skip_space();
+        if (p == end) fail("unexpected end");
+        switch (*p)
+        {
+        case '"': value = string(valueBuffer); return true;
+        case 'n': literal("null"); return false;
+        case 't': value = literal("true"); return true;
+        case 'f': value = literal("false"); return true;
+        default: value = number(); return true;
+        }
+    }
+    // True (and consumes it) if the next value is null
+    inline bool null()
+    {
+        skip_space();
+        if (p == end || *p != 'n') return false;
+        literal("null");
+        return true;
+    }
+    inline void skip_value(std::size_t depth = 0)
+    {
+        if (depth == maxSkipDepth) fail("too deeply nested");
+        skip_space();
+        if (p == end) fail("unexpected end");
+        std::string_view value;
+        if (*p == '{') object([&](std::string_view) { skip_value(depth + 1); });
+        else if (*p == '[') array([&] { skip_value(depth + 1); });
+        else scalar(value);
+    }
+    // Checks that only whitespace is left
+    inline void finish()
+    {
+        skip_space();
+        if (p != end) fail("unexpected data after the document");
+    }
+
+private:
+    [[noreturn]] inline void fail(const char* what) const
+    {
+        throw ParseError(ParseError::Reason::MalformedJson, "Malformed json: "s + what + " at offset " + std::to_string(p - begin));
+    }
+    inline void skip_space()
+    {
+        while (p != end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+    }
+    inline bool consume(char c)
+    {
+        skip_space();
+        if (p == end || *p != c) return false;
+        ++p;
+        return true;
+    }
+    inline void expect(char c)
+    {
+        if (!consume(c))
+        {
+            const char message[] = {'e', 'x', 'p', 'e', 'c', 't', 'e', 'd', ' ', '\'', c, '\'', '\0'};
+            fail(message);
+        }
+    }
+    inline std::string_view literal(std::string_view word)
+    {
+        if (static_cast<std::size_t>(end - p) < word.size() || std::string_view(p, word.size()) != word) fail("invalid literal");
+        p += word.size();
+        return word;
+    }
+    // -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    inline std::string_view number()
+    {
+        const char* start = p;
+        auto digits = [&] {
+            const char* first = p;
+            while (p != end && unsigned(*p - '0') <= 9) ++p;
+            return p != first;
+        };
+        if (p != end && *p == '-') ++p;
+        if (p != end && *p == '0') ++p;
+        else if (!digits()) fail("invalid value");
+        if (p != end && *p == '.' && (++p, !digits())) fail("invalid number");
+        if (p != end && (*p == 'e' || *p == 'E'))
+        {
+            ++p;
+            if (p != end && (*p == '+' || *p == '-')) ++p;
+            if (!digits()) fail("invalid number");
+        }
+        return std::string_view(start, static_cast<std::size_t>(p - start));
+    }
+    inline std::string_view string(std::string& buffer)
+    {
+        skip_space();
+        if (p == end || *p != '"') fail("expected a string");
+        const char* start = ++p;
+        p += json_clean_prefix(p, end);
+        if (p != end && *p == '"') return std::string_view(start, static_cast<std::size_t>(p++ - start));
+        buffer.assign(start, p);
+        for (;;)
+        {
+            if (p == end) fail("unterminated string");
+            char c = *p++;
+            if (c == '"') return buffer;
+            if (c != '\\') fail("control character in string");
+            if (p == end) fail("unterminated string");
+            switch (c = *p++)
+            {
+            case '"': case '\\': case '/': buffer += c; break;
+            case 'b': buffer += '\b'; break;
+            case 'f': buffer += '\f'; break;
+            case 'n': buffer += '\n'; break;
+            case 'r': buffer += '\r'; break;
+            case 't': buffer += '\t'; break;
+            case 'u': append_utf8(buffer, code_point()); break;
+            default: fail("invalid escape");
+            }
+            auto clean = json_clean_prefix(p, end);
+            buffer.append(p, clean);
+            p += clean;
+        }
+    }
+    inline std::uint32_t hex4()
+    {
+        if (end - p < 4) fail("invalid escape");
+        std::uint32_t value = 0;
+        for (int i = 0; i < 4; ++i)
+        {
+            auto digit = hexValues[static_cast<unsigned char>(*p++)];
+            if (digit > 15) fail("invalid escape");
+            value = value << 4 | digit;
+        }
+        return value;
+    }
+    // The code point of \uXXXX (after the u), joining a surrogate pair
+    inline std::uint32_t code_point()
+    {
+        auto value = hex4();
+        if (value >= 0xdc00 && value <= 0xdfff) fail("unpaired surrogate");
+        if (value < 0xd800 || value > 0xdbff) return value;
+        if (end - p < 2 || p[0] != '\\' || p[1] != 'u') fail("unpaired surrogate");
+        p += 2;
+        auto low = hex4();
+        if (low < 0xdc00 || low > 0xdfff) fail("unpaired surrogate");
+        return 0x10000 + ((value - 0xd800) << 10) + (low - 0xdc00);
+    }
+    static inline void append_utf8(std::string& out, std::uint32_t c)
+    {
+        if (c < 0x80)
+        {
+            out += static_cast<char>(c);
+        }
+        else if (c < 0x800)
+        {
+            out += static_cast<char>(0xc0 | c >> 6);
+            out += static_cast<char>(0x80 | (c & 0x3f));
+        }
+        else if (c < 0x10000)
+        {
+            out += static_cast<char>(0xe0 | c >> 12);
+            out += static_cast<char>(0x80 | (c >> 6 & 0x3f));
+            out += static_cast<char>(0x80 | (c & 0x3f));
+        }
+        else
+        {
+            out += static_cast<char>(0xf0 | c >> 18);
+            out += static_cast<char>(0x80 | (c >> 12 & 0x3f));
+            out += static_cast<char>(0x80 | (c >> 6 & 0x3f));
+            out += static_cast<char>(0x80 | (c & 0x3f));
+        }
+    }
+
+    const char* begin;
+    const char* p;
+    const char* end;
+    std::string keyBuffer;
+    std::string valueBuffer;
+};
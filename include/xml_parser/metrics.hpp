@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "node_data.hpp"
+
+// Process wide parse counters and latency histograms per schema (root node
+// name). Every thread writes to its own shard without locking; the mutex is
+// only taken to claim a shard and to aggregate on read. A thread's shards
+// are released when it exits and claimed again by the next thread parsing
+// the same schema, so their number follows the threads alive at once.
+class MetricsRegistry
+{
+public:
+    static inline constexpr std::array<std::uint64_t, 12> latencyBucketsNs = {
+        1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 10000000, 100000000
+    };
+
+    static inline MetricsRegistry& global()
+    {
+        static MetricsRegistry registry;
+        return registry;
+    }
+
+    inline void enable(bool on = true) { enabledFlag.store(on, std::memory_order_relaxed); }
+    inline bool enabled() const { return enabledFlag.load(std::memory_order_relaxed); }
+
+    inline void record_parse(const char* schema, std::size_t bytes, std::chrono::nanoseconds latency)
+    {
+        auto& s = shard(schema);
+        add(s.documents, 1);
+        add(s.bytes, bytes);
+        observe(s, latency);
+    }
+    inline void record_failure(const char* schema, std::size_t bytes, ParseError::Reason reason, std::chrono::nanoseconds latency)
+    {
+        auto& s = shard(schema);
+        add(s.failures[static_cast<std::size_t>(reason)], 1);
+        add(s.bytes, bytes);
+        observe(s, latency);
+    }
+
+    // Shards allocated so far, per schema at most the threads that recorded
+    // at the same time
+    inline std::size_t shard_count() const
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->shards.size();
+    }
+
+    inline std::string exposition() const
+    {
+        struct Totals
+        {
+            std::uint64_t documents = 0, bytes = 0, latencySumNs = 0;
+            std::array<std::uint64_t, ParseError::reasonCount> failures{};
+            std::array<std::uint64_t, latencyBucketsNs.size() + 1> latency{};
+        };
+        std::map<std::string, Totals> totals;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            for (auto& s : state->shards)
+            {
+                auto& t = totals[s->schema];
+                t.documents += s->documents.load(std::memory_order_relaxed);
+                t.bytes += s->bytes.load(std::memory_order_relaxed);
+                t.latencySumNs += s->latencySumNs.load(std::memory_order_relaxed);
+                for (std::size_t i = 0; i < t.failures.size(); ++i) t.failures[i] += s->failures[i].load(std::memory_order_relaxed);
+                for (std::size_t i = 0; i < t.latency.size(); ++i) t.latency[i] += s->latency[i].load(std::memory_order_relaxed);
+            }
+        }
+
+        std::ostringstream os;
+        os << "# HELP xml_parser_documents_total Documents parsed successfully.\n"
+           << "# TYPE xml_parser_documents_total counter\n";
+        for (auto& [schema, t] : totals) os << "xml_parser_documents_total{schema=\"" << schema << "\"} " << t.documents << '\n';
+        os << "# HELP xml_parser_bytes_total Input bytes handed to parse.\n"
+           << "# TYPE xml_parser_bytes_total counter\n";
+        for (auto& [schema, t] : totals) os << "xml_parser_bytes_total{schema=\"" << schema << "\"} " << t.bytes << '\n';
+        os << "# HELP xml_parser_failures_total Documents rejected, by reason.\n"
+           << "# TYPE xml_parser_failures_total counter\n";
+        for (auto& [schema, t] : totals)
+        {
+            for (std::size_t i = 0; i < t.failures.size(); ++i)
+            {
+                os << "xml_parser_failures_total{schema=\"" << schema << "\",reason=\""
+                   << ParseError::reason_name(static_cast<ParseError::Reason>(i)) << "\"} " << t.failures[i] << '\n';
+            }
+        }
+        os << "# HELP xml_parser_parse_latency_seconds Parse latency including failures.\n"
+           << "# TYPE xml_parser_parse_latency_seconds histogram\n";
+        for (auto& [schema, t] : totals)
+        {
+            std::uint64_t cumulative = 0;
+            for (std::size_t i = 0; i < latencyBucketsNs.size(); ++i)
+            {
+                cumulative += t.latency[i];
+                os << "xml_parser_parse_latency_seconds_bucket{schema=\"" << schema << "\",le=\""
+                   << latencyBucketsNs[i] / 1e9 << "\"} " << cumulative << '\n';
+            }
+            cumulative += t.latency.back();
+            os << "xml_parser_parse_latency_seconds_bucket{schema=\"" << schema << "\",le=\"+Inf\"} " << cumulative << '\n'
+               << "xml_parser_parse_latency_seconds_sum{schema=\"" << schema << "\"} " << t.latencySumNs / 1e9 << '\n'
+               << "xml_parser_parse_latency_seconds_count{schema=\"" << schema << "\"} " << cumulative << '\n';
+        }
+        return os.str();
+    }
+    // Writes through a temporary file and renames it, so collectors reading
+    // the file never observe a partial exposition.
+    inline void write_exposition(const std::string& path) const
+    {
+        auto temporary = path + ".tmp";
+        {
+            std::ofstream out(temporary, std::ios::trunc);
+            out << exposition();
+            if (!out) throw std::runtime_error("Could not write metrics to "s + temporary);
+        }
+        if (std::rename(temporary.c_str(), path.c_str()))
+            throw std::runtime_error("Could not move metrics to "s + path);
+    }
+
+private:
+    struct Shard
+    {
+        const char* schema;
+        bool claimed = true;
+        std::atomic<std::uint64_t> documents{0};
+        std::atomic<std::uint64_t> bytes{0};
+        std::atomic<std::uint64_t> latencySumNs{0};
+        std::array<std::atomic<std::uint64_t>, ParseError::reasonCount> failures{};
+        std::array<std::atomic<std::uint64_t>, latencyBucketsNs.size() + 1> latency{};
+    };
+    // Shared with the threads' caches, which may outlive the registry
+    struct State
+    {
+        std::mutex mutex;
+        std::vector<std::unique_ptr<Shard>> shards;
+    };
+    // The shards a thread has claimed, released when it exits
+    struct ThreadShards
+    {
+        struct Entry
+        {
+            std::uint64_t registry;
+            const char* schema;
+            Shard* shard;
+            std::weak_ptr<State> state;
+        };
+        std::vector<Entry> entries;
+
+        inline ~ThreadShards()
+        {
+            for (auto& entry : entries)
+            {
+                auto state = entry.state.lock();
+                if (!state) continue;
+                std::lock_guard<std::mutex> lock(state->mutex);
+                entry.shard->claimed = false;
+            }
+        }
+    };
+
+    // Only the owning thread writes a shard, so a relaxed load/store pair is
+    // enough and avoids a locked instruction on the hot path. A shard changes
+    // owner under the mutex, which orders the writes of both owners.
+    static inline void add(std::atomic<std::uint64_t>& counter, std::uint64_t value)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+    static inline void observe(Shard& s, std::chrono::nanoseconds latency)
+    {
+        auto ns = static_cast<std::uint64_t>(latency.count());
+        std::size_t bucket = 0;
+        while (bucket < latencyBucketsNs.size() && ns > latencyBucketsNs[bucket]) ++bucket;
+        add(s.latency[bucket], 1);
+        add(s.latencySumNs, ns);
+    }
+
+    // Ids are never reused, unlike the address of a destroyed registry
+    static inline std::uint64_t next_id()
+    {
+        static std::atomic<std::uint64_t> id{0};
+        return id.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    inline Shard& shard(const char* schema)
+    {
+        static thread_local ThreadShards cache;
+        for (auto& entry : cache.entries) if (entry.registry == id && entry.schema == schema) return *entry.shard;
+
+        // Entries of destroyed registries are dropped here
+        auto& entries = cache.entries;
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [](auto& entry) { return entry.state.expired(); }), entries.end());
+        std::lock_guard<std::mutex> lock(state->mutex);
+        Shard* claimed = nullptr;
+        for (auto& s : state->shards)
+        {
+            if (s->claimed || s->schema != schema) continue;
+            claimed = s.get();
+            claimed->claimed = true;
+            break;
+        }
+        if (!claimed)
+        {
+            state->shards.push_back(std::make_unique<Shard>());
+            claimed = state->shards.back().get();
+            claimed->schema = schema;
+        }
+        entries.push_back({id, schema, claimed, state});
+        return *claimed;
+    }
+
+    std::atomic<bool> enabledFlag{false};
+    std::uint64_t id = next_id();
+    std::shared_ptr<State> state = std::make_shared<State>();
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+// Bounded lock-free multi-producer/multi-consumer queue (Dmitry Vyukov's
+// sequence-numbered ring). Values are moved in and out, never copied. The
+// blocking push/pop spin with yield; close() lets consumers drain the queue
+// and then stop.
+template<class T>
+class MpmcQueue
+{
+public:
+    inline explicit MpmcQueue(std::size_t capacity)
+    {
+        std::size_t size = 2;
+        while (size < capacity) size *= 2;
+        mask = size - 1;
+        cells = std::make_unique<Cell[]>(size);
+        for (std::size_t i = 0; i < size; ++i) cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    inline ~MpmcQueue()
+    {
+        T value;
+        while (try_pop(value)) { }
+    }
+    MpmcQueue(const MpmcQueue&) = delete;
+    MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+    inline std::size_t capacity() const { return mask + 1; }
+
+    // Leaves value untouched and returns false when the queue is full.
+    inline bool try_push(T&& value)
+    {
+        auto pos = enqueuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;)
+        {
+            cell = &cells[pos & mask];
+            auto sequence = cell->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos);
+            if (difference == 0)
+            {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (difference < 0) return false;
+            else pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+        new (&cell->storage) T(std::move(value));
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+    inline bool try_pop(T& value)
+    {
+        auto pos = dequeuePos.load(std::memory_order_relaxed);
+        Cell* cell;
+        for (;;)
+        {
+            cell = &cells[pos & mask];
+            auto sequence = cell->sequence.load(std::memory_order_acquire);
+            auto difference = static_cast<std::intptr_t>(sequence) - static_cast<std::intptr_t>(pos + 1);
+            if (difference == 0)
+            {
+                if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+            }
+            else if (difference < 0) return false;
+            else pos = dequeuePos.load(std::memory_order_relaxed);
+        }
+        auto* stored = std::launder(reinterpret_cast<T*>(&cell->storage));
+        value = std::move(*stored);
+        stored->~T();
+        cell->sequence.store(pos + mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    inline void push(T&& value)
+    {
+        while (!try_push(std::move(value))) std::this_thread::yield();
+    }
+    // Returns false once the queue is closed and drained.
+    inline bool pop(T& value)
+    {
+        for (;;)
+        {
+            if (try_pop(value)) return true;
+            if (closed.load(std::memory_order_acquire)) return try_pop(value);
+            std::this_thread::yield();
+        }
+    }
+    inline void close()
+    {
+        closed.store(true, std::memory_order_release);
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<std::size_t> sequence;
+        std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+    };
+
+    std::unique_ptr<Cell[]> cells;
+    std::size_t mask;
+    alignas(64) std::atomic<std::size_t> enqueuePos{0};
+    alignas(64) std::atomic<std::size_t> dequeuePos{0};
+    alignas(64) std::atomic<bool> closed{false};
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "field_values.hpp"
+
+using namespace std::literals::string_literals;
+
+// Value of a typed field instead of its text. std::uint8_t is the index of
+// an Enum value, which NodeData keeps in its enums rather than its values.
+using FieldValue = std::variant<std::uint8_t, Timestamp, Decimal, Bytes>;
+
+// Enum indices by field name, sorted by name. A map node holding a
+// FieldValue takes 96 bytes and an allocation per field; an entry here
+// takes 40 (the name and the index byte), all entries of a node in one
+// allocation.
+class EnumValues
+{
+public:
+    using value_type = std::pair<std::string, std::uint8_t>;
+    using const_iterator = std::vector<value_type>::const_iterator;
+
+    inline const_iterator begin() const { return entries.begin(); }
+    inline const_iterator end() const { return entries.end(); }
+    inline std::size_t size() const { return entries.size(); }
+    inline bool empty() const { return entries.empty(); }
+
+    inline const_iterator find(std::string_view name) const
+    {
+        auto it = lower_bound(name);
+        return it != entries.end() && it->first == name ? it : entries.end();
+    }
+    inline void set(std::string_view name, std::uint8_t index)
+    {
+        auto it = lower_bound(name);
+        if (it != entries.end() && it->first == name) it->second = index;
+        else entries.emplace(it, std::string(name), index);
+    }
+    inline void erase(std::string_view name)
+    {
+        auto it = lower_bound(name);
+        if (it != entries.end() && it->first == name) entries.erase(it);
+    }
+
+    inline bool operator==(const EnumValues& other) const { return entries == other.entries; }
+    inline bool operator!=(const EnumValues& other) const { return entries != other.entries; }
+
+private:
+    inline std::vector<value_type>::iterator lower_bound(std::string_view name)
+    {
+        return std::lower_bound(entries.begin(), entries.end(), name, [](const value_type& entry, std::string_view n) { return entry.first < n; });
+    }
+    inline const_iterator lower_bound(std::string_view name) const
+    {
+        return std::lower_bound(entries.begin(), entries.end(), name, [](const value_type& entry, std::string_view n) { return entry.first < n; });
+    }
+
+    std::vector<value_type> entries;
+};
+
+struct NodeData
+{
+    std::string name;
+    std::string text;
+    std::map<std::string, std::vector<NodeData>> subnodes;
+    std::map<std::string, std::string> attributes;
+    // Typed attributes by name, a typed text as "#text"; Enums in enums
+    std::map<std::string, FieldValue> values;
+    EnumValues enums;
+};
+inline bool operator==(const NodeData& a, const NodeData& b)
+{
+    return a.name == b.name && a.text == b.text && a.attributes == b.attributes && a.values == b.values && a.enums == b.enums
+        && a.subnodes == b.subnodes;
+}
+inline bool operator!=(const NodeData& a, const NodeData& b)
+{
+    return !(a == b);
+}
+
+
+class ParseError : public std::runtime_error
+{
+public:
+    enum class Reason { MalformedXml, MissingNode, UnexpectedNode, MissingAttribute, MissingText, InvalidValue, MalformedJson, MalformedWire, SchemaMismatch, Other };
+    static inline constexpr std::size_t reasonCount = static_cast<std::size_t>(Reason::Other) + 1;
+
+    inline ParseError(Reason reason, const std::string& what)
+        : std::runtime_error(what), reason(reason)
+    { }
+
+    static inline const char* reason_name(Reason reason)
+    {
+        switch (reason)
+        {
+        case Reason::MalformedXml: return "malformed_xml";
+        case Reason::MissingNode: return "missing_node";
+        case Reason::UnexpectedNode: return "unexpected_node";
+        case Reason::MissingAttribute: return "missing_attribute";
+        case Reason::MissingText: return "missing_text";
+        case Reason::InvalidValue: return "invalid_value";
+        case Reason::MalformedJson: return "malformed_json";
+        case Reason::MalformedWire: return "malformed_wire";
+        case Reason::SchemaMismatch: return "schema_mismatch";
+        default: return "other";
+        }
+    }
+
+    Reason reason;
+};
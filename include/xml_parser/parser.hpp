@@ -0,0 +1,213 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pugixml.hpp>
+#include "metrics.hpp"
+#include "mpmc_queue.hpp"
+#include "node_data.hpp"
+#include "profiler.hpp"
+#include "schema.hpp"
+
+inline void check_load(pugi::xml_parse_result result)
+{
+    if (!result) throw ParseError(ParseError::Reason::MalformedXml, "Malformed xml: "s + result.description());
+}
+inline void load_document(pugi::xml_document& doc, const std::string& s)
+{
+    ProfileScope scope("#load");
+    scope.bytes = s.size();
+    check_load(doc.load_buffer(s.data(), s.size()));
+}
+inline void load_document_inplace(pugi::xml_document& doc, std::string& buffer)
+{
+    ProfileScope scope("#load");
+    scope.bytes = buffer.size();
+    check_load(doc.load_buffer_inplace(buffer.data(), buffer.size()));
+}
+template<class NodeDescription>
+inline NodeData parse_element(pugi::xml_node root, NodeDescription& desc)
+{
+    NodeData data;
+    desc.validate(root);
+    desc.parse(data, root);
+    return data;
+}
+// Runs parseFunction and, if metrics are enabled, accounts it to the schema
+// of NodeDescription.
+template<class NodeDescription, class ParseFunction>
+inline NodeData parse_measured(std::size_t size, ParseFunction&& parseFunction)
+{
+    auto& metrics = MetricsRegistry::global();
+    if (!metrics.enabled()) return parseFunction();
+
+    auto schema = NodeName<NodeDescription>::name;
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&] { return std::chrono::steady_clock::now() - start; };
+    try
+    {
+        auto data = parseFunction();
+        metrics.record_parse(schema, size, elapsed());
+        return data;
+    }
+    catch (const ParseError& e)
+    {
+        metrics.record_failure(schema, size, e.reason, elapsed());
+        throw;
+    }
+    catch (...)
+    {
+        metrics.record_failure(schema, size, ParseError::Reason::Other, elapsed());
+        throw;
+    }
+}
+template<class NodeDescription>
+inline auto parse(const std::string& s, NodeDescription desc)
+{
+    return parse_measured<NodeDescription>(s.size(), [&] {
+        pugi::xml_document doc;
+        load_document(doc, s);
+        return parse_element(doc.document_element(), desc);
+    });
+}
+template<class NodeDescription>
+inline auto parse(const std::string& s, NodeDescription desc, ParseProfiler& profiler)
+{
+    struct Activation
+    {
+        ParseProfiler* previous;
+        ~Activation() { ParseProfiler::active() = previous; }
+    } activation{std::exchange(ParseProfiler::active(), &profiler)};
+    return parse(s, desc);
+}
+// Streaming NodeList mode: entries of the lists directly below the root are
+// passed to sink as soon as each is parsed instead of being collected. The
+// returned NodeData holds the rest, including lists inside other nodes.
+template<class NodeDescription, class Sink>
+inline NodeData parse_stream(const std::string& s, NodeDescription desc, Sink&& sink)
+{
+    std::function<void(NodeData&&)> function = [&](NodeData&& record) { sink(std::move(record)); };
+    struct Activation
+    {
+        std::function<void(NodeData&&)>* previous;
+        ~Activation() { RecordSink::active() = previous; }
+    } activation{std::exchange(RecordSink::active(), &function)};
+    return parse(s, desc);
+}
+// Moves every record into the queue, waiting while it is full. The queue is
+// not closed, so several documents can feed the same consumers.
+template<class NodeDescription>
+inline NodeData parse_stream(const std::string& s, NodeDescription desc, MpmcQueue<NodeData>& queue)
+{
+    return parse_stream(s, desc, [&](NodeData&& record) { queue.push(std::move(record)); });
+}
+// Runs parseFunction with sink as the active TextSink
+template<class Sink, class ParseFunction>
+inline NodeData parse_with_text_sink(Sink& sink, ParseFunction&& parseFunction)
+{
+    TextSink::Function function = [&](const NodeData& node, std::string_view chunk, bool last) { sink(node, chunk, last); };
+    struct Activation
+    {
+        TextSink::Function* previous;
+        ~Activation() { TextSink::active() = previous; }
+    } activation{std::exchange(TextSink::active(), &function)};
+    return parseFunction();
+}
+// Chunked Text mode: the content of every Text(Chunked<size>()) is passed to
+// sink(node, chunk, last) straight from the parse buffer instead of being
+// copied into NodeData::text. The input is parsed in place, so a moved-in
+// buffer is the only copy of the text.
+template<class NodeDescription, class Sink>
+inline NodeData parse_chunked(std::string s, NodeDescription desc, Sink&& sink)
+{
+    return parse_with_text_sink(sink, [&] {
+        return parse_measured<NodeDescription>(s.size(), [&] {
+            pugi::xml_document doc;
+            load_document_inplace(doc, s);
+            return parse_element(doc.document_element(), desc);
+        });
+    });
+}
+// As parse_chunked for a file, parsed in place from a private mapping. Only
+// pages pugixml writes to (tag ends, unescaped text) become process memory;
+// the text itself stays in the page cache, where it can be reclaimed.
+template<class NodeDescription, class Sink>
+inline NodeData parse_chunked_file(const std::string& path, NodeDescription desc, Sink&& sink)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("Could not open "s + path);
+    struct stat info;
+    if (fstat(fd, &info))
+    {
+        close(fd);
+        throw std::runtime_error("Could not stat "s + path);
+    }
+    auto size = static_cast<std::size_t>(info.st_size);
+    void* memory = size ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0) : nullptr;
+    close(fd);
+    if (memory == MAP_FAILED) throw std::runtime_error("Could not map "s + path);
+    struct Mapping
+    {
+        void* memory;
+        std::size_t size;
+        ~Mapping() { if (memory) munmap(memory, size); }
+    } mapping{memory, size};
+    if (memory) madvise(memory, size, MADV_SEQUENTIAL);
+
+    return parse_with_text_sink(sink, [&] {
+        return parse_measured<NodeDescription>(size, [&] {
+            pugi::xml_document doc;
+            {
+                ProfileScope scope("#load");
+                scope.bytes = size;
+                check_load(doc.load_buffer_inplace(memory, size));
+            }
+            return parse_element(doc.document_element(), desc);
+        });
+    });
+}
+template<class NodeDescription>
+inline auto serialize(const NodeData& data, NodeDescription desc)
+{
+    pugi::xml_document doc;
+    auto root = doc.append_child(data.name.c_str());
+    std::apply([&](auto&... args) { serialize_subnodes(root, data, args...); }, desc.args);
+    desc.validate(root);
+    std::stringstream ss;
+    doc.print(ss, "", pugi::format_raw);
+    return ss.str();
+}
+
+// Parses a sequence of documents with one schema, keeping the input buffer
+// and pugixml document between calls. The input is parsed in place from the
+// reused buffer, which saves pugixml's own copy of every message.
+template<class NodeDescription>
+class Parser
+{
+public:
+    inline Parser(NodeDescription desc)
+        : desc(desc)
+    { }
+
+    inline NodeData parse(std::string_view s)
+    {
+        return parse_measured<NodeDescription>(s.size(), [&] {
+            buffer.assign(s);
+            load_document_inplace(doc, buffer);
+            return parse_element(doc.document_element(), desc);
+        });
+    }
+
+private:
+    NodeDescription desc;
+    pugi::xml_document doc;
+    std::string buffer;
+};
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Collects time and bytes per schema node path (e.g. root/data/@id) while it
+// is the active profiler of the parsing thread. Times are self times, so the
+// folded output can be fed to flamegraph.pl directly.
+class ParseProfiler
+{
+public:
+    enum class Weight { Time, Bytes };
+
+    struct Entry
+    {
+        std::chrono::nanoseconds time{};
+        std::size_t bytes = 0;
+        std::size_t count = 0;
+    };
+
+    static inline ParseProfiler*& active()
+    {
+        static thread_local ParseProfiler* profiler = nullptr;
+        return profiler;
+    }
+
+    inline void enter(const char* name)
+    {
+        std::string path = frames.empty() ? name : frames.back().path + '/' + name;
+        frames.push_back({std::move(path), std::chrono::steady_clock::now(), {}});
+    }
+    inline void leave(std::size_t bytes)
+    {
+        auto elapsed = std::chrono::steady_clock::now() - frames.back().start;
+        auto& entry = entries[frames.back().path];
+        entry.time += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed - frames.back().children);
+        entry.bytes += bytes;
+        ++entry.count;
+        frames.pop_back();
+        if (!frames.empty()) frames.back().children += elapsed;
+    }
+
+    inline void write_folded(std::ostream& os, Weight weight = Weight::Time) const
+    {
+        for (auto& [path, entry] : entries)
+        {
+            auto value = weight == Weight::Time ? static_cast<std::size_t>(entry.time.count()) : entry.bytes;
+            if (value == 0) continue;
+            std::string stack = path;
+            for (auto& c : stack) if (c == '/') c = ';';
+            os << stack << ' ' << value << '\n';
+        }
+    }
+
+    std::map<std::string, Entry> entries;
+
+private:
+    struct Frame
+    {
+        std::string path;
+        std::chrono::steady_clock::time_point start;
+        std::chrono::steady_clock::duration children;
+    };
+    std::vector<Frame> frames;
+};
+
+// Records a profiler frame for the lifetime of the scope; a no-op unless a
+// profiler is active on this thread.
+class ProfileScope
+{
+public:
+    inline ProfileScope(const char* name)
+        : profiler(ParseProfiler::active())
+    {
+        if (profiler) profiler->enter(name);
+    }
+    inline ~ProfileScope()
+    {
+        if (profiler) profiler->leave(bytes);
+    }
+
+    std::size_t bytes = 0;
+
+private:
+    ParseProfiler* profiler;
+};
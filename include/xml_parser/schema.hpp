@@ -0,0 +1,1650 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <pugixml.hpp>
+#include "binary_codecs.hpp"
+#include "field_values.hpp"
+#include "json_escape.hpp"
+#include "json_reader.hpp"
+#include "node_data.hpp"
+#include "profiler.hpp"
+#include "wire_codec.hpp"
+#include "worker_pool.hpp"
+
+class Required;
+class copy_t {};
+
+class NodeBase {};
+template<const char* name, class... Args>
+class Node;
+class AttributeBase {};
+template<const char* name, class... Args>
+class Attribute;
+
+inline void parse_subnodes(NodeData& data, pugi::xml_node& node);
+template<class NodeDescription, class... NodeDescriptions>
+inline void parse_subnodes(NodeData& data, pugi::xml_node& node, NodeDescription desc, NodeDescriptions... descs);
+template<class Random>
+inline void generate_subnodes(NodeData& data, Random& random);
+template<class Random, class NodeDescription, class... NodeDescriptions>
+inline void generate_subnodes(NodeData& data, Random& random, NodeDescription desc, NodeDescriptions... descs);
+template<std::size_t field, std::size_t record, class Handler>
+inline void emit_subnodes(Handler& handler, pugi::xml_node& node);
+template<std::size_t field, std::size_t record, class Handler, class NodeDescription, class... NodeDescriptions>
+inline void emit_subnodes(Handler& handler, pugi::xml_node& node, NodeDescription desc, NodeDescriptions... descs);
+inline void transcode_json_subnodes(std::string& out, pugi::xml_node& node);
+template<class NodeDescription, class... NodeDescriptions>
+inline void transcode_json_subnodes(std::string& out, pugi::xml_node& node, NodeDescription desc, NodeDescriptions... descs);
+inline void serialize_json_subnodes(std::string& out, const NodeData& data);
+template<class NodeDescription, class... NodeDescriptions>
+inline void serialize_json_subnodes(std::string& out, const NodeData& data, NodeDescription desc, NodeDescriptions... descs);
+
+// Random text that survives a pugixml round trip: never whitespace only and
+// without characters that are normalized on load (\r, \t, \n).
+template<class Random>
+inline std::string generate_text(Random& random, bool allowEmpty)
+{
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789 <>&\"'";
+    std::size_t length = std::uniform_int_distribution<std::size_t>(allowEmpty ? 0 : 1, 16)(random);
+    std::string text;
+    for (std::size_t i = 0; i < length; ++i)
+        text += alphabet[std::uniform_int_distribution<std::size_t>(0, sizeof(alphabet) - 2)(random)];
+    if (!text.empty() && text.find_first_not_of(' ') == std::string::npos) text.back() = 'x';
+    return text;
+}
+
+template<class... Args>
+struct is_required;
+template<>
+struct is_required<> : std::false_type { };
+template<class Arg, class... Args>
+struct is_required<Arg, Args...> : std::conditional_t<std::is_same_v<Arg, Required>, std::true_type, is_required<Args...>> { };
+template<class... Args>
+constexpr bool is_required_v = is_required<Args...>::value;
+
+template<const char* value_>
+class Default
+{
+public:
+    static inline constexpr const char* value = value_;
+};
+
+template<class... Args>
+struct default_value
+{
+    static inline constexpr const char* value = nullptr;
+};
+template<const char* value_, class... Args>
+struct default_value<Default<value_>, Args...>
+{
+    static inline constexpr const char* value = value_;
+};
+template<class Arg, class... Args>
+struct default_value<Arg, Args...> : default_value<Args...> { };
+template<class... Args>
+constexpr const char* default_value_v = default_value<Args...>::value;
+template<class Arg>
+struct is_default : std::false_type { };
+template<const char* value_>
+struct is_default<Default<value_>> : std::true_type { };
+
+// Compile-time helpers of Enum
+inline constexpr std::uint32_t enum_hash(std::string_view value, std::uint32_t seed)
+{
+    std::uint32_t hash = 2166136261u ^ seed;
+    for (char c : value) hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+    return hash;
+}
+template<std::size_t count, std::size_t size>
+inline constexpr std::array<std::string_view, count> enum_names(const std::array<char, size>& text)
+{
+    std::array<std::string_view, count> names{};
+    std::size_t begin = 0, i = 0;
+    for (std::size_t end = 0; end < size; ++end)
+    {
+        if (text[end]) continue;
+        names[i++] = std::string_view(text.data() + begin, end - begin);
+        begin = end + 1;
+    }
+    return names;
+}
+// The first seed for which the names hash to distinct slots, or -1 if
+// there is none (in particular, if a name occurs twice).
+template<std::size_t slots, std::size_t count>
+inline constexpr std::int64_t enum_seed(const std::array<std::string_view, count>& names)
+{
+    for (std::uint32_t seed = 0; seed < 1000; ++seed)
+    {
+        std::array<bool, slots> used{};
+        bool perfect = true;
+        for (auto& name : names)
+        {
+            auto slot = enum_hash(name, seed) & (slots - 1);
+            if (used[slot]) { perfect = false; break; }
+            used[slot] = true;
+        }
+        if (perfect) return seed;
+    }
+    return -1;
+}
+template<std::size_t slots, std::size_t count>
+inline constexpr std::array<std::uint8_t, slots> enum_table(const std::array<std::string_view, count>& names, std::uint32_t seed)
+{
+    std::array<std::uint8_t, slots> table{};
+    for (auto& index : table) index = 0xff;
+    for (std::size_t i = 0; i < count; ++i) table[enum_hash(names[i], seed) & (slots - 1)] = static_cast<std::uint8_t>(i);
+    return table;
+}
+
+// Schema fingerprints are FNV-1a hashes of the schema's structure, fed
+// with NUL terminated tokens so that no two sequences of tokens collide
+inline constexpr std::uint64_t fingerprintBasis = 0xcbf29ce484222325ull;
+inline constexpr std::uint64_t fingerprint_text(std::uint64_t hash, std::string_view text)
+{
+    for (char c : text) hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+    // The terminating NUL
+    return hash * 0x100000001b3ull;
+}
+inline constexpr std::uint64_t fingerprint_flag(std::uint64_t hash, bool flag)
+{
+    return fingerprint_text(hash, flag ? "1" : "0");
+}
+// An absent Default differs from every default value, "" included
+inline constexpr std::uint64_t fingerprint_default(std::uint64_t hash, const char* value)
+{
+    return value ? fingerprint_text(fingerprint_text(hash, "="), value) : hash;
+}
+
+// Field types parse the text of an attribute or a Text into a typed value
+// stored in NodeData::values (NodeData::enums for an Enum). A field type
+// provides value_type, read() (false for invalid text), valid() (the same
+// check at compile time, for Defaults), write(), view() for the typed
+// accessors, generate() for random documents and fingerprint() for the
+// schema's.
+class FieldTypeBase {};
+
+// Fixed vocabulary, written "a|b|c"_enum. A value is looked up with a
+// perfect hash computed at compile time and stored as its one-byte index
+// in NodeData::enums; any other value is rejected.
+template<char... chars>
+class Enum : FieldTypeBase
+{
+public:
+    using value_type = std::uint8_t;
+
+    static inline constexpr std::size_t count = 1 + ((chars == '|') + ... + 0);
+    static_assert(count < 0xff, "An Enum has at most 254 values");
+
+    // The values, NUL terminated, in the order they are written
+    static inline constexpr std::array<char, sizeof...(chars) + 1> text = {(chars == '|' ? '\0' : chars)..., '\0'};
+    static inline constexpr std::array<std::string_view, count> names = enum_names<count>(text);
+
+    // Index of value, or -1 if it is not one of the names
+    static inline constexpr int find(std::string_view value)
+    {
+        auto index = table[enum_hash(value, static_cast<std::uint32_t>(seed)) & (slots - 1)];
+        return index != 0xff && names[index] == value ? index : -1;
+    }
+
+    static inline constexpr bool valid(std::string_view text) { return find(text) >= 0; }
+    static inline bool read(std::string_view text, std::uint8_t& value)
+    {
+        int index = find(text);
+        value = static_cast<std::uint8_t>(index);
+        return index >= 0;
+    }
+    static inline std::string write(std::uint8_t value) { return std::string(names[value]); }
+    static inline std::string_view view(std::uint8_t value) { return value < count ? names[value] : std::string_view(); }
+    template<class Random>
+    static inline std::uint8_t generate(Random& random) { return static_cast<std::uint8_t>(random() % count); }
+    static inline constexpr std::uint64_t fingerprint(std::uint64_t hash)
+    {
+        hash = fingerprint_text(hash, "enum");
+        for (auto name : names) hash = fingerprint_text(hash, name);
+        return hash;
+    }
+
+private:
+    // At least count squared slots, so a perfect seed is found after a few tries
+    static inline constexpr std::size_t slots = [] {
+        std::size_t slots = 1;
+        while (slots < count * count) slots *= 2;
+        return slots;
+    }();
+    static inline constexpr std::int64_t seed = enum_seed<slots>(names);
+    static_assert(seed >= 0, "Enum values must be distinct");
+    static inline constexpr std::array<std::uint8_t, slots> table = enum_table<slots>(names, static_cast<std::uint32_t>(seed));
+};
+
+// ISO 8601 date-time (see parse_timestamp), stored as a UTC Timestamp
+class Iso8601 : FieldTypeBase
+{
+public:
+    using value_type = Timestamp;
+
+    static inline constexpr bool valid(std::string_view text) { return timestamp_valid(text); }
+    static inline bool read(std::string_view text, Timestamp& value) { return parse_timestamp(text, value); }
+    static inline std::string write(const Timestamp& value) { return format_timestamp(value); }
+    static inline Timestamp view(const Timestamp& value) { return value; }
+    template<class Random>
+    static inline Timestamp generate(Random& random)
+    {
+        auto seconds = std::uniform_int_distribution<std::int64_t>(timestampMin, timestampMax)(random);
+        auto nanoseconds = random() % 2 ? 0 : std::uniform_int_distribution<std::uint32_t>(0, 999999999)(random);
+        return {seconds, nanoseconds};
+    }
+    static inline constexpr std::uint64_t fingerprint(std::uint64_t hash) { return fingerprint_text(hash, "iso8601"); }
+};
+
+// Decimal number with scale fraction digits, stored as a Decimal
+template<unsigned scale_>
+class FixedPoint : FieldTypeBase
+{
+public:
+    static inline constexpr unsigned scale = scale_;
+    static_assert(scale <= 18, "A FixedPoint has at most 18 fraction digits");
+    using value_type = Decimal;
+
+    static inline constexpr bool valid(std::string_view text) { return decimal_valid(text, scale); }
+    static inline bool read(std::string_view text, Decimal& value) { return parse_decimal(text, scale, value); }
+    static inline std::string write(const Decimal& value) { return format_decimal(value); }
+    static inline Decimal view(const Decimal& value) { return value; }
+    template<class Random>
+    static inline Decimal generate(Random& random)
+    {
+        return {static_cast<std::int64_t>(random()), static_cast<std::uint8_t>(scale)};
+    }
+    static inline constexpr std::uint64_t fingerprint(std::uint64_t hash)
+    {
+        const char digits[] = {static_cast<char>('0' + scale / 10), static_cast<char>('0' + scale % 10), 0};
+        return fingerprint_text(fingerprint_text(hash, "fixed"), digits);
+    }
+};
+
+// Binary content written in Base64, decoded into Bytes while parsing
+class Base64 : FieldTypeBase
+{
+public:
+    using value_type = Bytes;
+
+    static inline constexpr bool valid(std::string_view text) { return base64_valid(text); }
+    static inline bool read(std::string_view text, Bytes& value) { return decode_base64(text, value); }
+    static inline std::string write(const Bytes& value) { return encode_base64(value); }
+    static inline const Bytes& view(const Bytes& value) { return value; }
+    template<class Random>
+    static inline Bytes generate(Random& random)
+    {
+        Bytes value(std::uniform_int_distribution<std::size_t>(1, 64)(random));
+        for (auto& byte : value) byte = static_cast<std::uint8_t>(random());
+        return value;
+    }
+    static inline constexpr std::uint64_t fingerprint(std::uint64_t hash) { return fingerprint_text(hash, "base64"); }
+};
+// Binary content written as hexadecimal digits, decoded into Bytes
+class Hex : FieldTypeBase
+{
+public:
+    using value_type = Bytes;
+
+    static inline constexpr bool valid(std::string_view text) { return hex_valid(text); }
+    static inline bool read(std::string_view text, Bytes& value) { return decode_hex(text, value); }
+    static inline std::string write(const Bytes& value) { return encode_hex(value); }
+    static inline const Bytes& view(const Bytes& value) { return value; }
+    template<class Random>
+    static inline Bytes generate(Random& random) { return Base64::generate(random); }
+    static inline constexpr std::uint64_t fingerprint(std::uint64_t hash) { return fingerprint_text(hash, "hex"); }
+};
+
+template<class... Args>
+struct field_type_of
+{
+    using type = void;
+};
+template<class Arg, class... Args>
+struct field_type_of<Arg, Args...>
+    : std::conditional_t<std::is_base_of_v<FieldTypeBase, Arg>, field_type_of<Arg>, field_type_of<Args...>> { };
+template<class Arg>
+struct field_type_of<Arg>
+{
+    using type = std::conditional_t<std::is_base_of_v<FieldTypeBase, Arg>, Arg, void>;
+};
+template<class... Args>
+using field_type_of_t = typename field_type_of<Args...>::type;
+
+// False if a Default among Args is not valid text of the field type Type
+template<class Type, class... Args>
+inline constexpr bool default_valid()
+{
+    if constexpr (std::is_void_v<Type> || !(is_default<std::decay_t<Args>>::value || ...)) return true;
+    else return Type::valid(default_value_v<Args...>);
+}
+
+// A field's contribution to the schema fingerprint: plain text or its type
+template<class Type>
+inline constexpr std::uint64_t field_fingerprint(std::uint64_t hash)
+{
+    if constexpr (std::is_void_v<Type>) return fingerprint_text(hash, "string");
+    else return Type::fingerprint(hash);
+}
+
+// The stored value of a typed field, nullptr when absent
+template<class Type>
+inline const typename Type::value_type* find_field(const NodeData& data, const char* key)
+{
+    if constexpr (std::is_same_v<typename Type::value_type, std::uint8_t>)
+    {
+        auto it = data.enums.find(key);
+        return it != data.enums.end() ? &it->second : nullptr;
+    }
+    else
+    {
+        auto it = data.values.find(key);
+        return it != data.values.end() ? &std::get<typename Type::value_type>(it->second) : nullptr;
+    }
+}
+template<class Type>
+inline void store_field(NodeData& data, const char* key, typename Type::value_type value)
+{
+    if constexpr (std::is_same_v<typename Type::value_type, std::uint8_t>) data.enums.set(key, value);
+    else data.values[key] = std::move(value);
+}
+template<class Type>
+inline void erase_field(NodeData& data, const char* key)
+{
+    if constexpr (std::is_same_v<typename Type::value_type, std::uint8_t>) data.enums.erase(key);
+    else data.values.erase(key);
+}
+// Stores text as a value of a field type, key naming the field in errors.
+// Returns the size of the stored value for the profiler.
+template<class Type>
+inline std::size_t parse_field(NodeData& data, const char* key, std::string_view text)
+{
+    typename Type::value_type value;
+    if (!Type::read(text, value))
+        throw ParseError(ParseError::Reason::InvalidValue, "Unexpected value "s + std::string(text) + " of "s + key);
+    std::size_t size = sizeof(value);
+    if constexpr (std::is_same_v<decltype(value), Bytes>) size = value.size();
+    store_field<Type>(data, key, std::move(value));
+    return size;
+}
+// The typed value of key passed through view(). An absent value is the
+// Default (valid, see default_valid), or else what reading empty text
+// leaves: an Enum's empty name and a zero value otherwise.
+template<class Type, const char* defaultValue>
+inline decltype(auto) get_field(const NodeData& data, const char* key)
+{
+    using value_type = typename Type::value_type;
+    static const value_type fallback = [] {
+        value_type value{};
+        Type::read(defaultValue != nullptr ? defaultValue : "", value);
+        return value;
+    }();
+    auto* value = find_field<Type>(data, key);
+    return Type::view(value ? *value : fallback);
+}
+
+// Lets a Text pass its content to the active TextSink in chunks of at most
+// size bytes instead of storing it; see parse_chunked.
+template<std::size_t size = 64 * 1024>
+class Chunked
+{
+public:
+    static_assert(size > 0, "Chunks must not be empty");
+};
+
+template<class... Args>
+struct chunk_size
+{
+    static inline constexpr std::size_t value = 0;
+};
+template<std::size_t size, class... Args>
+struct chunk_size<Chunked<size>, Args...>
+{
+    static inline constexpr std::size_t value = size;
+};
+template<class Arg, class... Args>
+struct chunk_size<Arg, Args...> : chunk_size<Args...> { };
+template<class... Args>
+constexpr std::size_t chunk_size_v = chunk_size<Args...>::value;
+
+// While set on a thread, Chunked texts parsed there are passed to the sink
+// as (node being parsed, chunk, last chunk) instead of being stored.
+struct TextSink
+{
+    using Function = std::function<void(const NodeData&, std::string_view, bool)>;
+
+    static inline Function*& active()
+    {
+        static thread_local Function* sink = nullptr;
+        return sink;
+    }
+};
+
+template<class NodeType>
+struct NodeName;
+template<const char* name_, class... Args>
+struct NodeName<Node<name_, Args...>>
+{
+    static inline constexpr const char* name = name_;
+};
+template<const char* name_, class... Args>
+struct NodeName<Attribute<name_, Args...>>
+{
+    static inline constexpr const char* name = name_;
+};
+
+// Run-time description of a Node, built once per Node type by describe()
+// for consumers that are not templates, e.g. PullCursor.
+struct SchemaAttribute
+{
+    const char* name;
+    bool required;
+    const char* defaultValue;
+    bool (*check)(const char* value);   // nullptr if any text is valid
+};
+struct SchemaElement;
+struct SchemaChild
+{
+    const SchemaElement* element;
+    bool list;
+};
+struct SchemaElement
+{
+    const char* name;
+    bool required;
+    std::vector<SchemaAttribute> attributes;
+    std::vector<SchemaChild> children;
+    bool text = false;
+    bool textRequired = false;
+    const char* textDefault = nullptr;
+    bool (*checkText)(const char* value) = nullptr;
+    std::size_t depth = 1;   // of the deepest path of elements from here
+};
+
+// Whether text is a valid value of a field type, for SchemaAttribute::check
+template<class Type>
+inline bool check_field(const char* text)
+{
+    if constexpr (std::is_void_v<Type>) return true;
+    else
+    {
+        // Reused, so checking binary values allocates only while it grows
+        static thread_local typename Type::value_type value;
+        return Type::read(text, value);
+    }
+}
+
+// Passes a field's value to handler.field(id, value): a string_view of
+// the text, or with a field type the value read into a buffer reused by
+// every field of that type on the thread (an Enum's as its index).
+template<class Type, class Handler, std::size_t field>
+inline void emit_field(Handler& handler, std::integral_constant<std::size_t, field> id, const char* key, const char* text)
+{
+    if constexpr (!std::is_void_v<Type>)
+    {
+        static thread_local typename Type::value_type value;
+        if (!Type::read(text, value))
+            throw ParseError(ParseError::Reason::InvalidValue, "Unexpected value "s + text + " of "s + key);
+        handler.field(id, std::as_const(value));
+    }
+    else
+    {
+        handler.field(id, std::string_view(text));
+    }
+}
+
+// JSON members: an attribute is "name": value, a text "#text": value, a
+// Node "name": {...} and a NodeList "name": [{...}, ...]. A value is a
+// string, or with a field type its write() form (a FixedPoint as a number).
+template<const char* name>
+inline void append_json_key(std::string& out)
+{
+    static const std::string key = "\""s + name + "\":";
+    append_json_separator(out);
+    out += key;
+}
+template<class Type>
+inline void append_json_value(std::string& out, const typename Type::value_type& value)
+{
+    if constexpr (std::is_same_v<typename Type::value_type, Decimal>) out += format_decimal(value);
+    else append_json_string(out, Type::write(value));
+}
+// Appends the JSON value of a field's text, checked as parse() would
+template<class Type>
+inline void transcode_json_field(std::string& out, const char* key, const char* text)
+{
+    if constexpr (!std::is_void_v<Type>)
+    {
+        static thread_local typename Type::value_type value;
+        if (!Type::read(text, value))
+            throw ParseError(ParseError::Reason::InvalidValue, "Unexpected value "s + text + " of "s + key);
+        append_json_value<Type>(out, value);
+    }
+    else
+    {
+        append_json_string(out, text);
+    }
+}
+
+// Wire form of a typed value: an Enum's index as one byte, a Timestamp as
+// the zigzag varint seconds and varint nanoseconds, a Decimal as its
+// zigzag varint units (the scale is the type's) and Bytes as a varint
+// length and the bytes.
+template<class Type>
+inline void append_wire_value(std::string& out, const typename Type::value_type& value)
+{
+    using value_type = typename Type::value_type;
+    if constexpr (std::is_same_v<value_type, std::uint8_t>)
+    {
+        out += static_cast<char>(value);
+    }
+    else if constexpr (std::is_same_v<value_type, Timestamp>)
+    {
+        append_varint(out, zigzag(value.seconds));
+        append_varint(out, value.nanoseconds);
+    }
+    else if constexpr (std::is_same_v<value_type, Decimal>)
+    {
+        append_varint(out, zigzag(value.units));
+    }
+    else
+    {
+        static_assert(std::is_same_v<value_type, Bytes>, "No wire form for this field type");
+        append_wire_string(out, std::string_view(reinterpret_cast<const char*>(value.data()), value.size()));
+    }
+}
+// Reads a typed value, checked as reading its text would be
+template<class Type>
+inline typename Type::value_type read_wire_value(WireReader& reader, const char* key)
+{
+    using value_type = typename Type::value_type;
+    value_type value{};
+    bool valid = true;
+    if constexpr (std::is_same_v<value_type, std::uint8_t>)
+    {
+        value = reader.byte();
+        valid = value < Type::count;
+    }
+    else if constexpr (std::is_same_v<value_type, Timestamp>)
+    {
+        value.seconds = unzigzag(reader.varint());
+        auto nanoseconds = reader.varint();
+        value.nanoseconds = static_cast<std::uint32_t>(nanoseconds);
+        valid = value.seconds >= timestampMin && value.seconds <= timestampMax && nanoseconds < 1000000000;
+    }
+    else if constexpr (std::is_same_v<value_type, Decimal>)
+    {
+        value = {unzigzag(reader.varint()), static_cast<std::uint8_t>(Type::scale)};
+    }
+    else
+    {
+        auto bytes = reader.string();
+        value.assign(bytes.begin(), bytes.end());
+    }
+    if (!valid) throw ParseError(ParseError::Reason::InvalidValue, "Unexpected value of "s + key);
+    return value;
+}
+
+class Required
+{
+public:
+    Required() { }
+
+    inline auto subnode(pugi::xml_node node) { return node; }
+    inline bool validate(pugi::xml_node node) { return true; }
+    inline void parse(NodeData& data, pugi::xml_node node) { }
+    template<class ParentNode>
+    inline void serialize(ParentNode& parent, const NodeData& data) { }
+    template<class Random>
+    inline void generate(NodeData& data, Random& random) { }
+    static inline void describe(SchemaElement& element) { }
+
+    static inline constexpr std::size_t fieldCount = 0;
+    static inline constexpr std::size_t recordCount = 0;
+    static inline constexpr std::ptrdiff_t field_id(std::string_view path, std::size_t first = 0) { return -1; }
+    static inline constexpr std::ptrdiff_t record_id(std::string_view path, std::size_t first = 0) { return -1; }
+    template<std::size_t field, std::size_t record, class Handler>
+    inline void emit(Handler& handler, pugi::xml_node node) { }
+    inline void transcode_json(std::string& out, pugi::xml_node node) { }
+    inline void serialize_json(std::string& out, const NodeData& data) { }
+    static inline bool json_matches(std::string_view key) { return false; }
+    inline void parse_json(JsonReader& reader, NodeData& data) { }
+    inline void parse_json_missing(NodeData& data) { }
+    static inline constexpr std::size_t wireMinSize = 0;
+    inline void encode_wire(std::string& out, const NodeData& data) { }
+    inline void decode_wire(WireReader& reader, NodeData& data) { }
+    // Part of the fingerprint of the node or field it makes required
+    static inline constexpr std::uint64_t fingerprint(std::uint64_t hash) { return hash; }
+};
+
+template<const char* name, class... Args>
+class Attribute : AttributeBase
+{
+public:
+    // The attribute's field type, or void for a text attribute
+    using Type = field_type_of_t<Args...>;
+
+    // A value equal to the Default is not stored, which a Required
+    // attribute could then not serialize
+    static_assert(!is_required_v<Args...> || !(is_default<std::decay_t<Args>>::value || ...),
+                  "A Required attribute cannot have a Default");
+    static_assert(default_valid<Type, Args...>(), "The Default is not a valid value of the field type");
+
+    inline Attribute(Args&&... args)
+    { }
+
+    inline bool validate(pugi::xml_attribute attr)
+    {
+        if (!attr)
+        {
+            if (is_required_v<Args...>) throw ParseError(ParseError::Reason::MissingAttribute, "Expected xml attribute "s + name);
+            return false;
+        }
+        return true;
+    }
+    inline auto subnode(pugi::xml_node node)
+    {
+        auto attr = node.attribute(name);
+        return attr;
+    }
+    inline void parse(NodeData& data, pugi::xml_attribute attr)
+    {
+        static const std::string path = "@"s + name;
+        ProfileScope scope(path.c_str());
+        // A value equal to the default is implied by the schema and not stored
+        if constexpr (default_value_v<Args...> != nullptr)
+        {
+            if (!std::strcmp(attr.as_string(), default_value_v<Args...>)) return;
+        }
+        if constexpr (!std::is_void_v<Type>)
+        {
+            scope.bytes = parse_field<Type>(data, name, attr.as_string());
+        }
+        else
+        {
+            auto& value = data.attributes[name] = attr.as_string();
+            scope.bytes = value.size();
+        }
+    }
+    // The attribute's value, falling back to its Default (or "" without one)
+    // when the attribute is absent from data. With a field type, the value
+    // is its view(): the name for an Enum, else the typed value.
+    static inline decltype(auto) get(const NodeData& data)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            return get_field<Type, default_value_v<Args...>>(data, name);
+        }
+        else
+        {
+            auto it = data.attributes.find(name);
+            if (it != data.attributes.end()) return std::string_view(it->second);
+            if constexpr (default_value_v<Args...> != nullptr) return std::string_view(default_value_v<Args...>);
+            return std::string_view();
+        }
+    }
+    // Index of an Enum attribute's value, for switching over
+    // Type::find("..."); -1 when absent without a Default.
+    static inline int index(const NodeData& data)
+    {
+        static_assert(!std::is_void_v<Type>, "index() requires an Enum attribute");
+        if (auto* value = find_field<Type>(data, name)) return *value;
+        if constexpr (default_value_v<Args...> != nullptr) return Type::find(default_value_v<Args...>);
+        return -1;
+    }
+    static inline void describe(SchemaElement& element)
+    {
+        element.attributes.push_back({name, is_required_v<Args...>, default_value_v<Args...>,
+                                      std::is_void_v<Type> ? nullptr : &check_field<Type>});
+    }
+
+    // An attribute is one field, with the path "@name" inside its node
+    static inline constexpr std::size_t fieldCount = 1;
+    static inline constexpr std::size_t recordCount = 0;
+    static inline constexpr std::ptrdiff_t field_id(std::string_view path, std::size_t first = 0)
+    {
+        return !path.empty() && path[0] == '@' && path.substr(1) == name ? static_cast<std::ptrdiff_t>(first) : -1;
+    }
+    static inline constexpr std::ptrdiff_t record_id(std::string_view path, std::size_t first = 0) { return -1; }
+    template<std::size_t field, std::size_t record, class Handler>
+    inline void emit(Handler& handler, pugi::xml_attribute attr)
+    {
+        emit_field<Type>(handler, std::integral_constant<std::size_t, field>(), name, attr.as_string());
+    }
+    // Like parse(), leaves out a value equal to the default
+    inline void transcode_json(std::string& out, pugi::xml_attribute attr)
+    {
+        if constexpr (default_value_v<Args...> != nullptr)
+        {
+            if (!std::strcmp(attr.as_string(), default_value_v<Args...>)) return;
+        }
+        append_json_key<name>(out);
+        transcode_json_field<Type>(out, name, attr.as_string());
+    }
+    inline void serialize_json(std::string& out, const NodeData& data)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            auto* value = find_field<Type>(data, name);
+            if (!value) return;
+            append_json_key<name>(out);
+            append_json_value<Type>(out, *value);
+        }
+        else
+        {
+            auto it = data.attributes.find(name);
+            if (it == data.attributes.end()) return;
+            append_json_key<name>(out);
+            append_json_string(out, it->second);
+        }
+    }
+    // Reading the JSON form: the value may be any scalar, null is absent
+    static inline bool json_matches(std::string_view key) { return key == name; }
+    inline void parse_json(JsonReader& reader, NodeData& data)
+    {
+        std::string_view value;
+        if (!reader.scalar(value)) return parse_json_missing(data);
+        if constexpr (default_value_v<Args...> != nullptr)
+        {
+            if (value == default_value_v<Args...>) return;
+        }
+        if constexpr (!std::is_void_v<Type>) parse_field<Type>(data, name, value);
+        else data.attributes[name] = value;
+    }
+    inline void parse_json_missing(NodeData& data)
+    {
+        validate(pugi::xml_attribute());
+    }
+
+    static inline constexpr std::uint64_t fingerprint(std::uint64_t hash)
+    {
+        hash = fingerprint_flag(fingerprint_text(fingerprint_text(hash, "@"), name), is_required_v<Args...>);
+        return field_fingerprint<Type>(fingerprint_default(hash, default_value_v<Args...>));
+    }
+
+    // Wire form: the value (a varint length and the text without a field
+    // type), after a presence byte unless the attribute is Required
+    static inline constexpr std::size_t wireMinSize = 1;
+    inline void encode_wire(std::string& out, const NodeData& data)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            auto* value = find_field<Type>(data, name);
+            if (!encode_wire_presence(out, value)) return;
+            append_wire_value<Type>(out, *value);
+        }
+        else
+        {
+            auto it = data.attributes.find(name);
+            if (!encode_wire_presence(out, it != data.attributes.end())) return;
+            append_wire_string(out, it->second);
+        }
+    }
+    inline void decode_wire(WireReader& reader, NodeData& data)
+    {
+        if (!is_required_v<Args...> && !reader.presence()) return;
+        if constexpr (!std::is_void_v<Type>) store_field<Type>(data, name, read_wire_value<Type>(reader, name));
+        else data.attributes[name] = reader.string();
+    }
+    template<class ParentNode>
+    inline void serialize(ParentNode& parent, const NodeData& data)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            auto* value = find_field<Type>(data, name);
+            if (!value) return;
+            parent.append_attribute(name) = Type::write(*value).c_str();
+        }
+        else
+        {
+            auto it = data.attributes.find(name);
+            auto end = data.attributes.end();
+            if (it == end) return;
+            parent.append_attribute(name) = it->second.c_str();
+        }
+    }
+    template<class Random>
+    inline void generate(NodeData& data, Random& random)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            if (is_required_v<Args...> || random() % 2) store_field<Type>(data, name, Type::generate(random));
+            if constexpr (default_value_v<Args...> != nullptr)
+            {
+                if (get(data) == get(NodeData())) erase_field<Type>(data, name);
+            }
+        }
+        else
+        {
+            if (is_required_v<Args...> || random() % 2) data.attributes[name] = generate_text(random, true);
+            if constexpr (default_value_v<Args...> != nullptr)
+            {
+                if (get(data) == default_value_v<Args...>) data.attributes.erase(name);
+            }
+        }
+    }
+
+private:
+    inline bool encode_wire_presence(std::string& out, bool present)
+    {
+        if constexpr (is_required_v<Args...>)
+        {
+            if (!present) validate(pugi::xml_attribute());
+        }
+        else
+        {
+            out += static_cast<char>(present);
+        }
+        return present;
+    }
+};
+
+// Makes a Text serialize as CDATA sections, which need no escaping and are
+// read back without unescaping (as views of the input when parsed in place)
+class Cdata {};
+
+template<class... Args>
+constexpr bool is_cdata_v = std::disjunction_v<std::is_same<Args, Cdata>...>;
+
+// Calls fragment(text, last) for every PCDATA and CDATA child of element,
+// so text split by comments or CDATA sections is read completely. The
+// pointers are into pugixml's buffer; nothing is copied.
+template<class Fragment>
+inline void for_each_text_fragment(pugi::xml_node element, Fragment&& fragment)
+{
+    auto is_text = [](pugi::xml_node node) { return node.type() == pugi::node_pcdata || node.type() == pugi::node_cdata; };
+    pugi::xml_node current;
+    for (auto child = element.first_child(); child; child = child.next_sibling())
+    {
+        if (!is_text(child)) continue;
+        if (current) fragment(current.value(), false);
+        current = child;
+    }
+    if (current) fragment(current.value(), true);
+}
+// Calls read with the complete text of element. Only text made of several
+// fragments is concatenated, into merged; a single one is passed in place.
+template<class Read>
+inline void read_text(pugi::xml_node element, Read&& read, std::string& merged)
+{
+    const char* single = nullptr;
+    bool first = true;
+    merged.clear();
+    for_each_text_fragment(element, [&](const char* text, bool last) {
+        if (first && last) single = text;
+        else merged += text;
+        first = false;
+    });
+    read(single ? single : merged.c_str());
+}
+template<class Read>
+inline void read_text(pugi::xml_node element, Read&& read)
+{
+    std::string merged;
+    read_text(element, read, merged);
+}
+
+template<class... Args>
+class Text
+{
+public:
+    // The text's field type, or void for plain text
+    using Type = field_type_of_t<Args...>;
+    static_assert(default_valid<Type, Args...>(), "The Default is not a valid value of the field type");
+
+    inline Text(Args... args)
+    { }
+
+    inline auto subnode(pugi::xml_node node)
+    {
+        return node.text();
+    }
+    inline bool validate(pugi::xml_text text)
+    {
+        if (text.empty())
+        {
+            if (is_required_v<Args...>) throw ParseError(ParseError::Reason::MissingText, "A text node is required");
+            return false;
+        }
+        return true;
+    }
+    inline void parse(NodeData& data, pugi::xml_text textNode)
+    {
+        ProfileScope scope("#text");
+        auto element = textNode.data().parent();
+        if constexpr (chunk_size_v<Args...> != 0)
+        {
+            if (auto* sink = TextSink::active())
+            {
+                return for_each_text_fragment(element, [&](const char* text, bool last) { parse_chunks(*sink, data, text, last); });
+            }
+        }
+        if constexpr (!std::is_void_v<Type>)
+        {
+            read_text(element, [&](const char* text) { scope.bytes = parse_field<Type>(data, "#text", text); });
+        }
+        else
+        {
+            data.text.clear();
+            for_each_text_fragment(element, [&](const char* text, bool) { data.text += text; });
+            scope.bytes = data.text.size();
+        }
+    }
+    static inline void describe(SchemaElement& element)
+    {
+        element.text = true;
+        element.textRequired = is_required_v<Args...>;
+        element.textDefault = default_value_v<Args...>;
+        element.checkText = std::is_void_v<Type> ? nullptr : &check_field<Type>;
+    }
+
+    // A text is one field, with the path "#text" inside its node. Text made
+    // of several fragments is emitted merged, Chunked or not.
+    static inline constexpr std::size_t fieldCount = 1;
+    static inline constexpr std::size_t recordCount = 0;
+    static inline constexpr std::ptrdiff_t field_id(std::string_view path, std::size_t first = 0)
+    {
+        return path == "#text" ? static_cast<std::ptrdiff_t>(first) : -1;
+    }
+    static inline constexpr std::ptrdiff_t record_id(std::string_view path, std::size_t first = 0) { return -1; }
+    template<std::size_t field, std::size_t record, class Handler>
+    inline void emit(Handler& handler, pugi::xml_text textNode)
+    {
+        static thread_local std::string merged;
+        read_text(textNode.data().parent(), [&](const char* text) {
+            emit_field<Type>(handler, std::integral_constant<std::size_t, field>(), "#text", text);
+        }, merged);
+    }
+    inline void transcode_json(std::string& out, pugi::xml_text textNode)
+    {
+        static thread_local std::string merged;
+        read_text(textNode.data().parent(), [&](const char* text) {
+            append_json_separator(out);
+            out += "\"#text\":";
+            transcode_json_field<Type>(out, "#text", text);
+        }, merged);
+    }
+    inline void serialize_json(std::string& out, const NodeData& data)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            auto* value = find_field<Type>(data, "#text");
+            if (!value) return;
+            append_json_separator(out);
+            out += "\"#text\":";
+            append_json_value<Type>(out, *value);
+        }
+        else
+        {
+            if (data.text.empty()) return;
+            append_json_separator(out);
+            out += "\"#text\":";
+            append_json_string(out, data.text);
+        }
+    }
+    // As for an attribute; an empty text is absent, as in xml
+    static inline bool json_matches(std::string_view key) { return key == "#text"; }
+    inline void parse_json(JsonReader& reader, NodeData& data)
+    {
+        std::string_view value;
+        if (!reader.scalar(value) || value.empty()) return parse_json_missing(data);
+        if constexpr (!std::is_void_v<Type>) parse_field<Type>(data, "#text", value);
+        else data.text = value;
+    }
+    inline void parse_json_missing(NodeData& data)
+    {
+        if (is_required_v<Args...>) throw ParseError(ParseError::Reason::MissingText, "A text node is required");
+    }
+
+    // Chunked and Cdata change how the text is read and written, not what
+    // it holds, so they are not part of the fingerprint
+    static inline constexpr std::uint64_t fingerprint(std::uint64_t hash)
+    {
+        hash = fingerprint_flag(fingerprint_text(hash, "#text"), is_required_v<Args...>);
+        return field_fingerprint<Type>(fingerprint_default(hash, default_value_v<Args...>));
+    }
+
+    // Wire form: plain text as a varint length and the text, where empty
+    // is absent; a typed value as for an Attribute
+    static inline constexpr std::size_t wireMinSize = 1;
+    inline void encode_wire(std::string& out, const NodeData& data)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            auto* value = find_field<Type>(data, "#text");
+            if (!value) validate(pugi::xml_text());
+            if (!is_required_v<Args...>) out += static_cast<char>(value != nullptr);
+            if (value) append_wire_value<Type>(out, *value);
+        }
+        else
+        {
+            if (data.text.empty()) validate(pugi::xml_text());
+            append_wire_string(out, data.text);
+        }
+    }
+    inline void decode_wire(WireReader& reader, NodeData& data)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            if (!is_required_v<Args...> && !reader.presence()) return;
+            store_field<Type>(data, "#text", read_wire_value<Type>(reader, "#text"));
+        }
+        else
+        {
+            auto text = reader.string();
+            if (text.empty()) validate(pugi::xml_text());
+            else data.text = text;
+        }
+    }
+    template<class ParentNode>
+    inline void serialize(ParentNode& parent, const NodeData& data)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            auto* value = find_field<Type>(data, "#text");
+            if (!value) return;
+            set_text(parent, Type::write(*value).c_str());
+        }
+        else
+        {
+            set_text(parent, data.text.c_str());
+        }
+    }
+    // The text, or the Default (if any) when it is empty; with a field type
+    // the typed value as for Attribute::get.
+    static inline decltype(auto) get(const NodeData& data)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            return get_field<Type, default_value_v<Args...>>(data, "#text");
+        }
+        else
+        {
+            if constexpr (default_value_v<Args...> != nullptr)
+            {
+                if (data.text.empty()) return std::string_view(default_value_v<Args...>);
+            }
+            return std::string_view(data.text);
+        }
+    }
+    template<class Random>
+    inline void generate(NodeData& data, Random& random)
+    {
+        if constexpr (!std::is_void_v<Type>)
+        {
+            if (is_required_v<Args...> || random() % 2) store_field<Type>(data, "#text", Type::generate(random));
+        }
+        else
+        {
+            if (is_required_v<Args...> || random() % 2) data.text = generate_text(random, false);
+        }
+    }
+
+private:
+    static_assert(chunk_size_v<Args...> == 0 || std::is_void_v<Type>, "A Chunked text cannot have a field type");
+
+    // Finds the end of a fragment chunk by chunk, so the first chunk is
+    // delivered without a pass over the whole text
+    static inline void parse_chunks(TextSink::Function& sink, const NodeData& data, const char* text, bool lastFragment)
+    {
+        constexpr std::size_t size = chunk_size_v<Args...>;
+        for (;;)
+        {
+            // memchr stops at the terminator, so it never reads past it
+            if (auto* end = static_cast<const char*>(std::memchr(text, 0, size + 1)))
+                return sink(data, std::string_view(text, static_cast<std::size_t>(end - text)), lastFragment);
+            sink(data, std::string_view(text, size), false);
+            text += size;
+        }
+    }
+    template<class ParentNode>
+    static inline void set_text(ParentNode& parent, const char* text)
+    {
+        if constexpr (is_cdata_v<Args...>)
+        {
+            // "]]>" would end the section, so it is split between two
+            while (auto* end = std::strstr(text, "]]>"))
+            {
+                parent.append_child(pugi::node_cdata).set_value(std::string(text, end + 2).c_str());
+                text = end + 2;
+            }
+            parent.append_child(pugi::node_cdata).set_value(text);
+        }
+        else
+        {
+            parent.text().set(text);
+        }
+    }
+};
+
+template<const char* name, class... Args>
+class Node : NodeBase
+{
+public:
+    inline Node(copy_t copy, const Node& other)
+        : args{other.args}
+    { }
+    inline Node(Args... args)
+        : args{std::forward<Args>(args)...}
+    { }
+
+    inline bool validate(pugi::xml_node node)
+    {
+        if (!node)
+        {
+            if (is_required_v<Args...>) throw ParseError(ParseError::Reason::MissingNode, "Expected an xml node of name "s + name);
+            return false;
+        }
+        if (std::strcmp(name, node.name()))
+            throw ParseError(ParseError::Reason::UnexpectedNode, "Expected "s + name + " node instead of "s + node.name());
+        return true;
+    }
+    inline auto subnode(pugi::xml_node node)
+    {
+        auto subnode = node.child(name);
+        return subnode;
+    }
+    inline void parse(NodeData& data, pugi::xml_node node)
+    {
+        ProfileScope scope(name);
+        data.name = name;
+        scope.bytes = data.name.size();
+        std::apply([&](auto&... args) { parse_subnodes(data, node, args...); }, args);
+    }
+    template<class ParentNode>
+    inline void serialize(ParentNode& parent, const NodeData& data)
+    {
+        pugi::xml_node node = parent.append_child(data.name.c_str());
+        std::apply([&](auto&... args) { serialize_subnodes(node, data, args...); }, args);
+        validate(node);
+    }
+    template<class Random>
+    inline void generate(NodeData& data, Random& random)
+    {
+        data.name = name;
+        std::apply([&](auto&... args) { generate_subnodes(data, random, args...); }, args);
+    }
+    // The description of this node type
+    static inline const SchemaElement& schema()
+    {
+        static const SchemaElement element = [] {
+            SchemaElement element{name, is_required_v<Args...>, {}, {}};
+            (std::decay_t<Args>::describe(element), ...);
+            for (auto& child : element.children) element.depth = std::max(element.depth, child.element->depth + 1);
+            return element;
+        }();
+        return element;
+    }
+    static inline void describe(SchemaElement& parent)
+    {
+        parent.children.push_back({&schema(), false});
+    }
+
+    // Fields and records are numbered depth first in declaration order: a
+    // node is the record first, then come the ids of its arguments.
+    static inline constexpr std::size_t fieldCount = (std::size_t(0) + ... + std::decay_t<Args>::fieldCount);
+    static inline constexpr std::size_t recordCount = (std::size_t(1) + ... + std::decay_t<Args>::recordCount);
+    // Id of the field at path ("name/sub/@attr", "name/#text"), -1 if the
+    // schema has none there; constexpr with names from _node and _attr.
+    static inline constexpr std::ptrdiff_t field_id(std::string_view path, std::size_t first = 0)
+    {
+        if (!strip_name(path)) return -1;
+        std::ptrdiff_t id = -1;
+        ((id < 0 ? void((id = std::decay_t<Args>::field_id(path, first), first += std::decay_t<Args>::fieldCount)) : void()), ...);
+        return id;
+    }
+    // Id of the record of the node at path ("name/sub")
+    static inline constexpr std::ptrdiff_t record_id(std::string_view path, std::size_t first = 0)
+    {
+        if (path == name) return static_cast<std::ptrdiff_t>(first);
+        if (!strip_name(path)) return -1;
+        std::ptrdiff_t id = -1;
+        ++first;
+        ((id < 0 ? void((id = std::decay_t<Args>::record_id(path, first), first += std::decay_t<Args>::recordCount)) : void()), ...);
+        return id;
+    }
+    template<std::size_t field, std::size_t record, class Handler>
+    inline void emit(Handler& handler, pugi::xml_node node)
+    {
+        constexpr std::integral_constant<std::size_t, record> id;
+        handler.start_record(id, name);
+        std::apply([&](auto&... args) { emit_subnodes<field, record + 1>(handler, node, args...); }, args);
+        handler.end_record(id);
+    }
+    inline void transcode_json(std::string& out, pugi::xml_node node)
+    {
+        append_json_key<name>(out);
+        transcode_json_object(out, node);
+    }
+    // The node's JSON object, without a key
+    inline void transcode_json_object(std::string& out, pugi::xml_node node)
+    {
+        out += '{';
+        std::apply([&](auto&... args) { transcode_json_subnodes(out, node, args...); }, args);
+        out += '}';
+    }
+    inline void serialize_json(std::string& out, const NodeData& data)
+    {
+        append_json_key<name>(out);
+        serialize_json_object(out, data);
+    }
+    inline void serialize_json_object(std::string& out, const NodeData& data)
+    {
+        out += '{';
+        std::apply([&](auto&... args) { serialize_json_subnodes(out, data, args...); }, args);
+        out += '}';
+    }
+    static inline bool json_matches(std::string_view key) { return key == name; }
+    inline void parse_json(JsonReader& reader, NodeData& data)
+    {
+        if (reader.null()) return parse_json_missing(data);
+        parse_json_object(reader, data);
+    }
+    inline void parse_json_missing(NodeData& data)
+    {
+        validate(pugi::xml_node());
+    }
+    // Reads the node's object into data. Members are matched to the
+    // arguments by key, unknown ones skipped; the arguments without a
+    // member are then checked as absent from the xml.
+    inline void parse_json_object(JsonReader& reader, NodeData& data)
+    {
+        data.name = name;
+        std::array<bool, sizeof...(Args) + 1> seen{};
+        reader.object([&](std::string_view key) {
+            std::size_t index = 0;
+            bool matched = false;
+            std::apply([&](auto&... args) {
+                ((!matched && args.json_matches(key) ? void((matched = seen[index] = true, args.parse_json(reader, data))) : void(++index)), ...);
+            }, args);
+            if (!matched) reader.skip_value();
+        });
+        std::apply([&](auto&... args) {
+            std::size_t index = 0;
+            ((seen[index++] ? void() : args.parse_json_missing(data)), ...);
+        }, args);
+    }
+
+    // Hash of the names, order, requirements, defaults and field types of
+    // the schema below this node. Node::fingerprint() of the root is the
+    // schema's fingerprint, a constant with names from _node and _attr;
+    // wire documents and shared images carry it.
+    static inline constexpr std::uint64_t fingerprint(std::uint64_t hash = fingerprintBasis)
+    {
+        hash = fingerprint_flag(fingerprint_text(fingerprint_text(hash, "<"), name), is_required_v<Args...>);
+        ((hash = std::decay_t<Args>::fingerprint(hash)), ...);
+        return fingerprint_text(hash, ">");
+    }
+
+    // Wire form: the arguments in declaration order, without names
+    static inline constexpr std::size_t wireMinSize = (std::size_t(0) + ... + std::decay_t<Args>::wireMinSize);
+    inline void encode_wire(std::string& out, const NodeData& data)
+    {
+        std::apply([&](auto&... args) { (args.encode_wire(out, data), ...); }, args);
+    }
+    inline void decode_wire(WireReader& reader, NodeData& data)
+    {
+        data.name = name;
+        std::apply([&](auto&... args) { (args.decode_wire(reader, data), ...); }, args);
+    }
+
+    std::tuple<std::decay_t<Args>...> args;
+
+private:
+    // Removes "name/" from the front of path
+    static inline constexpr bool strip_name(std::string_view& path)
+    {
+        std::string_view own(name);
+        if (path.size() <= own.size() || path.substr(0, own.size()) != own || path[own.size()] != '/') return false;
+        path.remove_prefix(own.size() + 1);
+        return true;
+    }
+};
+
+// While set on a thread, the entries of the NodeLists of the root parsed
+// there are passed to the sink one by one instead of being stored; see
+// parse_stream. It is suspended below the root, in the entries and in the
+// nodes the root contains.
+struct RecordSink
+{
+    static inline std::function<void(NodeData&&)>*& active()
+    {
+        static thread_local std::function<void(NodeData&&)>* sink = nullptr;
+        return sink;
+    }
+
+    struct Suspension
+    {
+        std::function<void(NodeData&&)>* sink = std::exchange(active(), nullptr);
+        ~Suspension() { active() = sink; }
+    };
+};
+
+template<class SubNodeType, class... Args>
+class NodeList
+{
+public:
+    inline NodeList(const SubNodeType& node, Args... args)
+        : subNodeType(node)
+    { }
+
+    inline auto subnode(pugi::xml_node node)
+    {
+        auto children = node.children(NodeName<SubNodeType>::name);
+        return children;
+    }
+    inline bool validate(pugi::xml_object_range<pugi::xml_named_node_iterator> children)
+    {
+        for (auto& child : children) if (!subNodeType.validate(child)) return false;
+        return true;
+    }
+    inline void parse(NodeData& data, pugi::xml_object_range<pugi::xml_named_node_iterator> children)
+    {
+        auto& subnodes = data.subnodes[NodeName<SubNodeType>::name];
+        if (auto* sink = RecordSink::active()) return parse_records(*sink, children);
+        // Sinks and profilers are per thread and not shared with the
+        // workers running subtasks, so their parses are not split
+        auto* pool = WorkerPool::current();
+        if (pool && pool->splitGrain && !TextSink::active() && !ParseProfiler::active())
+        {
+            std::size_t count = 0;
+            for (auto it = children.begin(); it != children.end() && count < 2 * pool->splitGrain; ++it) ++count;
+            if (count == 2 * pool->splitGrain) return parse_split(*pool, subnodes, children);
+        }
+        for (auto& child : children)
+        {
+            subnodes.emplace_back();
+            auto& subnode = subnodes.back();
+            subNodeType.parse(subnode, child);
+        }
+    }
+    template<class ParentNode>
+    inline void serialize(ParentNode& parent, const NodeData& data)
+    {
+        auto it = data.subnodes.find(NodeName<SubNodeType>::name);
+        auto end = data.subnodes.end();
+        if (it == end) return;
+        for (auto& child : it->second) subNodeType.serialize(parent, child);
+    }
+    template<class Random>
+    inline void generate(NodeData& data, Random& random)
+    {
+        auto& subnodes = data.subnodes[NodeName<SubNodeType>::name];
+        subnodes.resize(random() % 5);
+        for (auto& subnode : subnodes) subNodeType.generate(subnode, random);
+    }
+    static inline void describe(SchemaElement& parent)
+    {
+        parent.children.push_back({&SubNodeType::schema(), true});
+    }
+
+    // Every entry has the ids of the sub node type
+    static inline constexpr std::size_t fieldCount = SubNodeType::fieldCount;
+    static inline constexpr std::size_t recordCount = SubNodeType::recordCount;
+    static inline constexpr std::ptrdiff_t field_id(std::string_view path, std::size_t first = 0)
+    {
+        return SubNodeType::field_id(path, first);
+    }
+    static inline constexpr std::ptrdiff_t record_id(std::string_view path, std::size_t first = 0)
+    {
+        return SubNodeType::record_id(path, first);
+    }
+    template<std::size_t field, std::size_t record, class Handler>
+    inline void emit(Handler& handler, pugi::xml_object_range<pugi::xml_named_node_iterator> children)
+    {
+        for (auto& child : children) subNodeType.template emit<field, record>(handler, child);
+    }
+    // A list is always written, as [] when it has no entries
+    inline void transcode_json(std::string& out, pugi::xml_object_range<pugi::xml_named_node_iterator> children)
+    {
+        append_json_key<NodeName<SubNodeType>::name>(out);
+        out += '[';
+        for (auto& child : children)
+        {
+            append_json_separator(out);
+            subNodeType.transcode_json_object(out, child);
+        }
+        out += ']';
+    }
+    inline void serialize_json(std::string& out, const NodeData& data)
+    {
+        append_json_key<NodeName<SubNodeType>::name>(out);
+        out += '[';
+        auto it = data.subnodes.find(NodeName<SubNodeType>::name);
+        if (it != data.subnodes.end())
+        {
+            for (auto& child : it->second)
+            {
+                append_json_separator(out);
+                subNodeType.serialize_json_object(out, child);
+            }
+        }
+        out += ']';
+    }
+    static inline bool json_matches(std::string_view key) { return key == NodeName<SubNodeType>::name; }
+    inline void parse_json(JsonReader& reader, NodeData& data)
+    {
+        auto& subnodes = data.subnodes[NodeName<SubNodeType>::name];
+        if (reader.null()) return;
+        reader.array([&] {
+            subnodes.emplace_back();
+            subNodeType.parse_json_object(reader, subnodes.back());
+        });
+    }
+    // Like an empty list in xml
+    inline void parse_json_missing(NodeData& data)
+    {
+        data.subnodes[NodeName<SubNodeType>::name];
+    }
+
+    static inline constexpr std::uint64_t fingerprint(std::uint64_t hash)
+    {
+        return SubNodeType::fingerprint(fingerprint_text(hash, "*"));
+    }
+
+    // Wire form: a varint count and the entries. An entry without fields
+    // is written as a zero byte, so every entry takes at least one byte.
+    static inline constexpr std::size_t wireMinSize = 1;
+    static inline constexpr std::size_t wireEntrySize = SubNodeType::wireMinSize ? SubNodeType::wireMinSize : 1;
+    inline void encode_wire(std::string& out, const NodeData& data)
+    {
+        auto it = data.subnodes.find(NodeName<SubNodeType>::name);
+        if (it == data.subnodes.end()) return append_varint(out, 0);
+        append_varint(out, it->second.size());
+        if constexpr (SubNodeType::wireMinSize == 0) out.append(it->second.size(), '\0');
+        else for (auto& child : it->second) subNodeType.encode_wire(out, child);
+    }
+    inline void decode_wire(WireReader& reader, NodeData& data)
+    {
+        auto& subnodes = data.subnodes[NodeName<SubNodeType>::name];
+        auto count = reader.varint();
+        // A count the remaining bytes cannot hold is rejected before
+        // anything is allocated for it
+        if (count > reader.remaining() / wireEntrySize) reader.fail("list longer than the document");
+        subnodes.reserve(subnodes.size() + count);
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            subnodes.emplace_back();
+            if constexpr (SubNodeType::wireMinSize == 0)
+            {
+                if (reader.byte()) reader.fail("invalid entry byte");
+            }
+            subNodeType.decode_wire(reader, subnodes.back());
+        }
+    }
+
+    SubNodeType subNodeType;
+
+private:
+    // Hands every entry to the sink instead of storing it. Lists nested in
+    // the entries are stored as usual.
+    inline void parse_records(std::function<void(NodeData&&)>& sink, pugi::xml_object_range<pugi::xml_named_node_iterator> children)
+    {
+        RecordSink::Suspension suspension;
+        for (auto& child : children)
+        {
+            NodeData record;
+            subNodeType.parse(record, child);
+            sink(std::move(record));
+        }
+    }
+    // Parses a long list as stealable subtasks of splitGrain entries each.
+    inline void parse_split(WorkerPool& pool, std::vector<NodeData>& subnodes, pugi::xml_object_range<pugi::xml_named_node_iterator> children)
+    {
+        std::vector<pugi::xml_node> nodes;
+        for (auto& child : children) nodes.push_back(child);
+        auto offset = subnodes.size();
+        subnodes.resize(offset + nodes.size());
+
+        TaskGroup group;
+        std::mutex errorMutex;
+        std::exception_ptr error;
+        for (std::size_t begin = 0; begin < nodes.size(); begin += pool.splitGrain)
+        {
+            auto end = std::min(begin + pool.splitGrain, nodes.size());
+            group.add();
+            pool.spawn([&, begin, end] {
+                // A worker may run this while waiting inside the parse of
+                // another document, whose sinks and profiler must not see it
+                struct Isolation
+                {
+                    TextSink::Function* textSink = std::exchange(TextSink::active(), nullptr);
+                    std::function<void(NodeData&&)>* recordSink = std::exchange(RecordSink::active(), nullptr);
+                    ParseProfiler* profiler = std::exchange(ParseProfiler::active(), nullptr);
+                    ~Isolation()
+                    {
+                        TextSink::active() = textSink;
+                        RecordSink::active() = recordSink;
+                        ParseProfiler::active() = profiler;
+                    }
+                } isolation;
+                try
+                {
+                    for (auto i = begin; i < end; ++i) subNodeType.parse(subnodes[offset + i], nodes[i]);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(errorMutex);
+                    if (!error) error = std::current_exception();
+                }
+                group.done();
+            });
+        }
+        pool.wait(group);
+        if (error) std::rethrow_exception(error);
+    }
+};
+
+inline void serialize_subnodes(pugi::xml_node& parent, const NodeData& data)
+{ }
+template<class NodeDescription, class... NodeDescriptions>
+inline void serialize_subnodes(pugi::xml_node& parent, const NodeData& data, NodeDescription desc, NodeDescriptions... descs)
+{
+    desc.serialize(parent, data);
+    serialize_subnodes(parent, data, descs...);
+}
+template<class Random>
+inline void generate_subnodes(NodeData& data, Random& random)
+{ }
+template<class Random, class NodeDescription, class... NodeDescriptions>
+inline void generate_subnodes(NodeData& data, Random& random, NodeDescription desc, NodeDescriptions... descs)
+{
+    desc.generate(data, random);
+    generate_subnodes(data, random, descs...);
+}
+inline void parse_subnodes(NodeData& data, pugi::xml_node& node)
+{ }
+template<class NodeDescription, class... NodeDescriptions>
+inline void parse_subnodes(NodeData& data, pugi::xml_node& node, NodeDescription desc, NodeDescriptions... descs)
+{
+    auto subnode = desc.subnode(node);
+    if constexpr (std::is_base_of_v<NodeBase, NodeDescription>)
+    {
+        // Only lists of the root stream their entries
+        RecordSink::Suspension suspension;
+        if (desc.validate(subnode)) desc.parse(data, subnode);
+    }
+    else if (desc.validate(subnode)) desc.parse(data, subnode);
+    parse_subnodes(data, node, descs...);
+}
+template<std::size_t field, std::size_t record, class Handler>
+inline void emit_subnodes(Handler& handler, pugi::xml_node& node)
+{ }
+template<std::size_t field, std::size_t record, class Handler, class NodeDescription, class... NodeDescriptions>
+inline void emit_subnodes(Handler& handler, pugi::xml_node& node, NodeDescription desc, NodeDescriptions... descs)
+{
+    auto subnode = desc.subnode(node);
+    if (desc.validate(subnode)) desc.template emit<field, record>(handler, subnode);
+    emit_subnodes<field + NodeDescription::fieldCount, record + NodeDescription::recordCount>(handler, node, descs...);
+}
+inline void transcode_json_subnodes(std::string& out, pugi::xml_node& node)
+{ }
+template<class NodeDescription, class... NodeDescriptions>
+inline void transcode_json_subnodes(std::string& out, pugi::xml_node& node, NodeDescription desc, NodeDescriptions... descs)
+{
+    auto subnode = desc.subnode(node);
+    if (desc.validate(subnode)) desc.transcode_json(out, subnode);
+    transcode_json_subnodes(out, node, descs...);
+}
+inline void serialize_json_subnodes(std::string& out, const NodeData& data)
+{ }
+template<class NodeDescription, class... NodeDescriptions>
+inline void serialize_json_subnodes(std::string& out, const NodeData& data, NodeDescription desc, NodeDescriptions... descs)
+{
+    desc.serialize_json(out, data);
+    serialize_json_subnodes(out, data, descs...);
+}
+
+
+template<const char* name>
+class NodeBuilder
+{
+public:
+    template<class... Args>
+    auto operator()(Args... args) {
+        return Node<name, Args...>(std::forward<Args>(args)...);
+    }
+};
+template<const char* name>
+class AttributeBuilder
+{
+public:
+    template<class... Args>
+    auto operator()(Args... args) {
+        return Attribute<name, Args...>(std::forward<Args>(args)...);
+    }
+};
+
+template<class CharT, CharT... chars> auto operator""_node()
+{
+    static constexpr char name[] = {chars..., 0};
+    return NodeBuilder<name>();
+}
+template<class CharT, CharT... chars> auto operator""_attr()
+{
+    static constexpr char name[] = {chars..., 0};
+    return AttributeBuilder<name>();
+}
+template<class CharT, CharT... chars> auto operator""_default()
+{
+    static constexpr char value[] = {chars..., 0};
+    return Default<value>();
+}
+template<class CharT, CharT... chars> auto operator""_enum()
+{
+    return Enum<chars...>();
+}
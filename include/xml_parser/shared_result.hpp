@@ -0,0 +1,401 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "node_data.hpp"
+#include "parser.hpp"
+
+// Position independent image of a NodeData tree: every reference is a byte
+// offset from the start of the image, attributes and lists are arrays sorted
+// by name, and strings are NUL terminated. Typed values are stored as
+// their FieldValue alternative index and payload. An image can be placed
+// in POSIX shared memory by one process and mapped read-only by others.
+// The header records the fingerprint of the schema the data was parsed
+// with (0 if not given), which readers may require to match.
+inline constexpr char sharedMagic[8] = {'X', 'M', 'L', 'P', 'S', 'H', 'M', 0};
+inline constexpr std::uint32_t sharedVersion = 5;
+
+struct SharedString
+{
+    std::uint64_t offset;
+    std::uint64_t size;
+};
+struct SharedAttribute
+{
+    SharedString name;
+    SharedString value;
+};
+// type is the FieldValue alternative: an Enum index, Timestamp seconds
+// and nanoseconds, Decimal units and scale or offset and size of Bytes
+struct SharedValue
+{
+    SharedString name;
+    std::uint64_t type;
+    std::uint64_t payload[2];
+};
+struct SharedNode
+{
+    SharedString name;
+    SharedString text;
+    std::uint64_t attributes;
+    std::uint64_t attributeCount;
+    std::uint64_t values;
+    std::uint64_t valueCount;
+    std::uint64_t lists;
+    std::uint64_t listCount;
+};
+struct SharedList
+{
+    SharedString name;
+    std::uint64_t nodes;
+    std::uint64_t count;
+};
+struct SharedHeader
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t reserved;
+    std::uint64_t size;
+    std::uint64_t schema;
+    SharedNode root;
+};
+
+// Lays out a tree. Without a buffer it only computes the size, so the
+// same code sizes the shared memory object and then fills it.
+class SharedLayoutWriter
+{
+public:
+    inline explicit SharedLayoutWriter(char* base = nullptr)
+        : base(base)
+    { }
+
+    inline std::uint64_t write(const NodeData& data, std::uint64_t schema = 0)
+    {
+        auto header = allocate(sizeof(SharedHeader));
+        SharedHeader h{};
+        std::memcpy(h.magic, sharedMagic, sizeof(sharedMagic));
+        h.version = sharedVersion;
+        h.schema = schema;
+        h.root = fill(data);
+        h.size = used;
+        store(header, h);
+        return used;
+    }
+
+private:
+    inline std::uint64_t allocate(std::uint64_t size)
+    {
+        auto offset = (used + 7) & ~std::uint64_t(7);
+        used = offset + size;
+        return offset;
+    }
+    template<class T>
+    inline void store(std::uint64_t offset, const T& value)
+    {
+        if (base) std::memcpy(base + offset, &value, sizeof(T));
+    }
+    inline SharedString string(const std::string& s)
+    {
+        auto offset = allocate(s.size() + 1);
+        if (base) std::memcpy(base + offset, s.c_str(), s.size() + 1);
+        return {offset, s.size()};
+    }
+    inline SharedValue shared_value(SharedString name, const FieldValue& value)
+    {
+        SharedValue v{name, value.index(), {}};
+        if (auto* index = std::get_if<std::uint8_t>(&value)) v.payload[0] = *index;
+        else if (auto* timestamp = std::get_if<Timestamp>(&value))
+        {
+            v.payload[0] = static_cast<std::uint64_t>(timestamp->seconds);
+            v.payload[1] = timestamp->nanoseconds;
+        }
+        else if (auto* decimal = std::get_if<Decimal>(&value))
+        {
+            v.payload[0] = static_cast<std::uint64_t>(decimal->units);
+            v.payload[1] = decimal->scale;
+        }
+        else if (auto* bytes = std::get_if<Bytes>(&value))
+        {
+            v.payload[0] = allocate(bytes->size());
+            v.payload[1] = bytes->size();
+            if (base && !bytes->empty()) std::memcpy(base + v.payload[0], bytes->data(), bytes->size());
+        }
+        return v;
+    }
+    inline SharedNode fill(const NodeData& data)
+    {
+        SharedNode node{};
+        node.name = string(data.name);
+        node.text = string(data.text);
+        node.attributeCount = data.attributes.size();
+        node.attributes = allocate(sizeof(SharedAttribute) * data.attributes.size());
+        std::uint64_t i = 0;
+        for (auto& [name, value] : data.attributes)
+            store(node.attributes + sizeof(SharedAttribute) * i++, SharedAttribute{string(name), string(value)});
+        // Enum indices join the typed values, merged into one sorted array
+        node.valueCount = data.values.size() + data.enums.size();
+        node.values = allocate(sizeof(SharedValue) * node.valueCount);
+        i = 0;
+        auto value = data.values.begin();
+        auto index = data.enums.begin();
+        while (value != data.values.end() || index != data.enums.end())
+        {
+            auto offset = node.values + sizeof(SharedValue) * i++;
+            if (index == data.enums.end() || (value != data.values.end() && value->first < index->first))
+            {
+                store(offset, shared_value(string(value->first), value->second));
+                ++value;
+            }
+            else
+            {
+                store(offset, shared_value(string(index->first), index->second));
+                ++index;
+            }
+        }
+        node.listCount = data.subnodes.size();
+        node.lists = allocate(sizeof(SharedList) * data.subnodes.size());
+        i = 0;
+        for (auto& [name, subnodes] : data.subnodes)
+        {
+            SharedList list{string(name), allocate(sizeof(SharedNode) * subnodes.size()), subnodes.size()};
+            for (std::size_t j = 0; j < subnodes.size(); ++j) store(list.nodes + sizeof(SharedNode) * j, fill(subnodes[j]));
+            store(node.lists + sizeof(SharedList) * i++, list);
+        }
+        return node;
+    }
+
+    char* base;
+    std::uint64_t used = 0;
+};
+
+class SharedNodeList;
+
+// Read-only view of a node inside an image; valid as long as the image is.
+class SharedNodeView
+{
+public:
+    inline SharedNodeView(const char* base, const SharedNode* node)
+        : base(base), node(node)
+    { }
+
+    inline std::string_view name() const { return string(node->name); }
+    inline std::string_view text() const { return string(node->text); }
+    inline std::optional<std::string_view> attribute(std::string_view name) const
+    {
+        auto* begin = reinterpret_cast<const SharedAttribute*>(base + node->attributes);
+        auto* end = begin + node->attributeCount;
+        auto it = std::lower_bound(begin, end, name, [&](auto& a, std::string_view n) { return string(a.name) < n; });
+        if (it == end || string(it->name) != name) return std::nullopt;
+        return string(it->value);
+    }
+    inline std::optional<FieldValue> value(std::string_view name) const
+    {
+        auto* begin = reinterpret_cast<const SharedValue*>(base + node->values);
+        auto* end = begin + node->valueCount;
+        auto it = std::lower_bound(begin, end, name, [&](auto& v, std::string_view n) { return string(v.name) < n; });
+        if (it == end || string(it->name) != name) return std::nullopt;
+        return field_value(*it);
+    }
+    inline SharedNodeList subnodes(std::string_view name) const;
+
+    inline NodeData to_node_data() const;
+
+private:
+    inline std::string_view string(const SharedString& s) const
+    {
+        return {base + s.offset, static_cast<std::size_t>(s.size)};
+    }
+    inline FieldValue field_value(const SharedValue& v) const
+    {
+        switch (v.type)
+        {
+        case 3:
+        {
+            auto* bytes = reinterpret_cast<const std::uint8_t*>(base + v.payload[0]);
+            return Bytes(bytes, bytes + v.payload[1]);
+        }
+        case 1: return Timestamp{static_cast<std::int64_t>(v.payload[0]), static_cast<std::uint32_t>(v.payload[1])};
+        case 2: return Decimal{static_cast<std::int64_t>(v.payload[0]), static_cast<std::uint8_t>(v.payload[1])};
+        default: return static_cast<std::uint8_t>(v.payload[0]);
+        }
+    }
+
+    const char* base;
+    const SharedNode* node;
+};
+
+class SharedNodeList
+{
+public:
+    inline SharedNodeList(const char* base = nullptr, const SharedNode* nodes = nullptr, std::size_t count = 0)
+        : base(base), nodes(nodes), count(count)
+    { }
+
+    inline std::size_t size() const { return count; }
+    inline bool empty() const { return count == 0; }
+    inline SharedNodeView operator[](std::size_t i) const { return {base, nodes + i}; }
+
+    class iterator
+    {
+    public:
+        inline iterator(const char* base, const SharedNode* node) : base(base), node(node) { }
+        inline SharedNodeView operator*() const { return {base, node}; }
+        inline iterator& operator++() { ++node; return *this; }
+        inline bool operator!=(const iterator& other) const { return node != other.node; }
+        inline bool operator==(const iterator& other) const { return node == other.node; }
+    private:
+        const char* base;
+        const SharedNode* node;
+    };
+    inline iterator begin() const { return {base, nodes}; }
+    inline iterator end() const { return {base, nodes + count}; }
+
+private:
+    const char* base;
+    const SharedNode* nodes;
+    std::size_t count;
+};
+
+inline SharedNodeList SharedNodeView::subnodes(std::string_view name) const
+{
+    auto* begin = reinterpret_cast<const SharedList*>(base + node->lists);
+    auto* end = begin + node->listCount;
+    auto it = std::lower_bound(begin, end, name, [&](auto& l, std::string_view n) { return string(l.name) < n; });
+    if (it == end || string(it->name) != name) return {};
+    return {base, reinterpret_cast<const SharedNode*>(base + it->nodes), static_cast<std::size_t>(it->count)};
+}
+inline NodeData SharedNodeView::to_node_data() const
+{
+    NodeData data;
+    data.name = name();
+    data.text = text();
+    auto* attributes = reinterpret_cast<const SharedAttribute*>(base + node->attributes);
+    for (std::uint64_t i = 0; i < node->attributeCount; ++i)
+        data.attributes.emplace(string(attributes[i].name), string(attributes[i].value));
+    auto* values = reinterpret_cast<const SharedValue*>(base + node->values);
+    for (std::uint64_t i = 0; i < node->valueCount; ++i)
+    {
+        auto value = field_value(values[i]);
+        if (auto* index = std::get_if<std::uint8_t>(&value)) data.enums.set(string(values[i].name), *index);
+        else data.values.emplace(string(values[i].name), std::move(value));
+    }
+    auto* lists = reinterpret_cast<const SharedList*>(base + node->lists);
+    for (std::uint64_t i = 0; i < node->listCount; ++i)
+    {
+        auto& subnodes = data.subnodes[std::string(string(lists[i].name))];
+        for (auto subnode : SharedNodeList(base, reinterpret_cast<const SharedNode*>(base + lists[i].nodes), lists[i].count))
+            subnodes.push_back(subnode.to_node_data());
+    }
+    return data;
+}
+
+// Lays data out into memory. The image is 8-byte aligned internally, so the
+// buffer must be too (std::vector<char> and mmap are).
+inline std::vector<char> build_shared_image(const NodeData& data, std::uint64_t schema = 0)
+{
+    std::vector<char> image(SharedLayoutWriter().write(data, schema));
+    SharedLayoutWriter(image.data()).write(data, schema);
+    return image;
+}
+// Checks the header of an image of the given size and returns its root.
+// Unless schema is 0, the image must have been built with that fingerprint.
+inline SharedNodeView view_shared_image(const char* image, std::size_t size, std::uint64_t schema = 0)
+{
+    auto* header = reinterpret_cast<const SharedHeader*>(image);
+    if (size < sizeof(SharedHeader) || std::memcmp(header->magic, sharedMagic, sizeof(sharedMagic)))
+        throw std::runtime_error("Not a shared result image");
+    if (header->version != sharedVersion)
+        throw std::runtime_error("Unsupported shared result version "s + std::to_string(header->version));
+    if (header->size > size)
+        throw std::runtime_error("Truncated shared result image");
+    if (schema && header->schema != schema)
+        throw std::runtime_error("Shared result image of another schema");
+    return {image, &header->root};
+}
+
+// Publishes data as the POSIX shared memory object name (e.g. "/orders"),
+// readable only by this user unless mode says otherwise. Fails if the
+// object already exists; remove it with unlink_shared().
+inline void publish_shared(const std::string& name, const NodeData& data, std::uint64_t schema = 0, mode_t mode = 0600)
+{
+    auto size = SharedLayoutWriter().write(data, schema);
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, mode);
+    if (fd < 0) throw std::runtime_error("Could not create shared memory "s + name);
+    if (ftruncate(fd, static_cast<off_t>(size)))
+    {
+        close(fd);
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Could not size shared memory "s + name);
+    }
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        shm_unlink(name.c_str());
+        throw std::runtime_error("Could not map shared memory "s + name);
+    }
+    SharedLayoutWriter(static_cast<char*>(memory)).write(data, schema);
+    munmap(memory, size);
+}
+inline void unlink_shared(const std::string& name)
+{
+    shm_unlink(name.c_str());
+}
+// Parses s and publishes the result, with the schema's fingerprint,
+// without returning it.
+template<class NodeDescription>
+inline void parse_shared(const std::string& s, NodeDescription desc, const std::string& name, mode_t mode = 0600)
+{
+    publish_shared(name, parse(s, desc), NodeDescription::fingerprint(), mode);
+}
+
+// Read-only mapping of a published result, of the given schema unless it
+// is 0 (e.g. SharedResult(name, decltype(schema)::fingerprint())).
+class SharedResult
+{
+public:
+    inline explicit SharedResult(const std::string& name, std::uint64_t schema = 0)
+    {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) throw std::runtime_error("Could not open shared memory "s + name);
+        struct stat info;
+        if (fstat(fd, &info))
+        {
+            close(fd);
+            throw std::runtime_error("Could not stat shared memory "s + name);
+        }
+        size = static_cast<std::size_t>(info.st_size);
+        memory = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED) throw std::runtime_error("Could not map shared memory "s + name);
+        try { rootView.emplace(view_shared_image(static_cast<const char*>(memory), size, schema)); }
+        catch (...)
+        {
+            munmap(memory, size);
+            throw;
+        }
+    }
+    inline ~SharedResult()
+    {
+        munmap(memory, size);
+    }
+    SharedResult(const SharedResult&) = delete;
+    SharedResult& operator=(const SharedResult&) = delete;
+
+    inline SharedNodeView root() const { return *rootView; }
+
+private:
+    void* memory;
+    std::size_t size;
+    std::optional<SharedNodeView> rootView;
+};
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "node_data.hpp"
+#include "parser.hpp"
+
+// Immutable NodeData tree with structural sharing. Copies are a pointer copy
+// and may be handed to any number of threads. A with_* modification returns
+// a new snapshot that copies only the nodes on the path from the root to the
+// modified node; every other subtree is shared with the original.
+class NodeSnapshot
+{
+public:
+    struct Data
+    {
+        std::string name;
+        std::string text;
+        std::map<std::string, std::vector<std::shared_ptr<const Data>>> subnodes;
+        std::map<std::string, std::string> attributes;
+        std::map<std::string, FieldValue> values;
+        EnumValues enums;
+    };
+    // Names a node below the root: index-th entry of the list of that name
+    struct Step
+    {
+        std::string list;
+        std::size_t index;
+    };
+    using Path = std::vector<Step>;
+
+    inline NodeSnapshot()
+        : root(std::make_shared<const Data>())
+    { }
+    inline explicit NodeSnapshot(const NodeData& data)
+        : root(build(NodeData(data)))
+    { }
+    inline explicit NodeSnapshot(NodeData&& data)
+        : root(build(std::move(data)))
+    { }
+
+    inline const std::string& name() const { return root->name; }
+    inline const std::string& text() const { return root->text; }
+    inline const std::map<std::string, std::string>& attributes() const { return root->attributes; }
+    inline const std::string* attribute(const std::string& name) const
+    {
+        auto it = root->attributes.find(name);
+        return it == root->attributes.end() ? nullptr : &it->second;
+    }
+    inline const std::map<std::string, FieldValue>& values() const { return root->values; }
+    inline const EnumValues& enums() const { return root->enums; }
+    // A typed value of either kind, like SharedNodeView::value
+    inline std::optional<FieldValue> value(const std::string& name) const
+    {
+        auto index = root->enums.find(name);
+        if (index != root->enums.end()) return FieldValue(index->second);
+        auto it = root->values.find(name);
+        if (it == root->values.end()) return std::nullopt;
+        return it->second;
+    }
+    inline std::size_t count(const std::string& list) const
+    {
+        auto it = root->subnodes.find(list);
+        return it == root->subnodes.end() ? 0 : it->second.size();
+    }
+    inline NodeSnapshot subnode(const std::string& list, std::size_t index) const
+    {
+        return NodeSnapshot(root->subnodes.at(list).at(index));
+    }
+    inline NodeSnapshot at(const Path& path) const
+    {
+        auto node = root;
+        for (auto& step : path) node = node->subnodes.at(step.list).at(step.index);
+        return NodeSnapshot(node);
+    }
+    // True if both snapshots are the same tree, not merely equal ones.
+    inline bool same(const NodeSnapshot& other) const { return root == other.root; }
+
+    inline NodeSnapshot with_attribute(const Path& path, const std::string& name, std::string value) const
+    {
+        return modify(path, [&](Data& node) { node.attributes[name] = std::move(value); });
+    }
+    inline NodeSnapshot without_attribute(const Path& path, const std::string& name) const
+    {
+        return modify(path, [&](Data& node) { node.attributes.erase(name); });
+    }
+    inline NodeSnapshot with_value(const Path& path, const std::string& name, FieldValue value) const
+    {
+        return modify(path, [&](Data& node) {
+            if (auto* index = std::get_if<std::uint8_t>(&value)) node.enums.set(name, *index);
+            else node.values[name] = std::move(value);
+        });
+    }
+    inline NodeSnapshot without_value(const Path& path, const std::string& name) const
+    {
+        return modify(path, [&](Data& node) {
+            node.values.erase(name);
+            node.enums.erase(name);
+        });
+    }
+    inline NodeSnapshot with_text(const Path& path, std::string text) const
+    {
+        return modify(path, [&](Data& node) { node.text = std::move(text); });
+    }
+    // Replaces the node at path (which must not be empty) by subtree.
+    inline NodeSnapshot with_subnode(const Path& path, const NodeSnapshot& subtree) const
+    {
+        if (path.empty()) return subtree;
+        Path parent(path.begin(), path.end() - 1);
+        return modify(parent, [&](Data& node) { node.subnodes.at(path.back().list).at(path.back().index) = subtree.root; });
+    }
+    inline NodeSnapshot with_appended(const Path& path, const std::string& list, const NodeSnapshot& subtree) const
+    {
+        return modify(path, [&](Data& node) { node.subnodes[list].push_back(subtree.root); });
+    }
+    inline NodeSnapshot without_subnode(const Path& path) const
+    {
+        if (path.empty()) return NodeSnapshot();
+        Path parent(path.begin(), path.end() - 1);
+        return modify(parent, [&](Data& node) {
+            auto& list = node.subnodes.at(path.back().list);
+            if (path.back().index >= list.size()) throw std::out_of_range("No entry " + std::to_string(path.back().index) + " in " + path.back().list);
+            list.erase(list.begin() + static_cast<std::ptrdiff_t>(path.back().index));
+        });
+    }
+
+    inline NodeData to_node_data() const
+    {
+        return to_node_data(*root);
+    }
+
+private:
+    inline explicit NodeSnapshot(std::shared_ptr<const Data> root)
+        : root(std::move(root))
+    { }
+
+    static inline std::shared_ptr<const Data> build(NodeData&& data)
+    {
+        auto node = std::make_shared<Data>();
+        node->name = std::move(data.name);
+        node->text = std::move(data.text);
+        node->attributes = std::move(data.attributes);
+        node->values = std::move(data.values);
+        node->enums = std::move(data.enums);
+        for (auto& [name, subnodes] : data.subnodes)
+        {
+            auto& list = node->subnodes[name];
+            list.reserve(subnodes.size());
+            for (auto& subnode : subnodes) list.push_back(build(std::move(subnode)));
+        }
+        return node;
+    }
+    static inline NodeData to_node_data(const Data& node)
+    {
+        NodeData data;
+        data.name = node.name;
+        data.text = node.text;
+        data.attributes = node.attributes;
+        data.values = node.values;
+        data.enums = node.enums;
+        for (auto& [name, subnodes] : node.subnodes)
+        {
+            auto& list = data.subnodes[name];
+            for (auto& subnode : subnodes) list.push_back(to_node_data(*subnode));
+        }
+        return data;
+    }
+
+    template<class Modification>
+    inline NodeSnapshot modify(const Path& path, Modification&& modification) const
+    {
+        return NodeSnapshot(copy_path(root, path, 0, modification));
+    }
+    // Copies one node (its strings and its lists of child pointers, not the
+    // children) per level of the path.
+    template<class Modification>
+    static inline std::shared_ptr<const Data> copy_path(const std::shared_ptr<const Data>& node, const Path& path, std::size_t depth, Modification& modification)
+    {
+        auto copy = std::make_shared<Data>(*node);
+        if (depth == path.size())
+        {
+            modification(*copy);
+        }
+        else
+        {
+            auto& child = copy->subnodes.at(path[depth].list).at(path[depth].index);
+            child = copy_path(child, path, depth + 1, modification);
+        }
+        return copy;
+    }
+
+    std::shared_ptr<const Data> root;
+};
+
+template<class NodeDescription>
+inline NodeSnapshot parse_snapshot(const std::string& s, NodeDescription desc)
+{
+    return NodeSnapshot(parse(s, desc));
+}
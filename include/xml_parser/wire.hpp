@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include "node_data.hpp"
+#include "parser.hpp"
+#include "schema.hpp"
+#include "wire_codec.hpp"
+
+// Compact binary form of a document for traffic between services that
+// share the schema. Names are implied by the schema: after the wireMagic
+// header and the schema fingerprint (so a document of another schema is
+// rejected before decoding) the root's fields follow in declaration
+// order, each in the encode_wire() form of its description (varint
+// lengths and counts, typed values in binary, presence bytes for optional
+// fields only).
+
+// Encodes data, which must conform to the schema as for serialize()
+template<class NodeDescription>
+inline std::string encode_wire(const NodeData& data, NodeDescription desc)
+{
+    std::string out;
+    append_wire_header(out, NodeDescription::fingerprint());
+    desc.encode_wire(out, data);
+    return out;
+}
+// Decodes into the NodeData parse() gives for the serialized document,
+// with the same checks of typed values. Malformed input is a ParseError
+// with the MalformedWire reason, a document of another schema one with
+// the SchemaMismatch reason.
+template<class NodeDescription>
+inline NodeData decode_wire(std::string_view s, NodeDescription desc)
+{
+    return parse_measured<NodeDescription>(s.size(), [&] {
+        WireReader reader(s);
+        reader.header(NodeDescription::fingerprint());
+        NodeData data;
+        desc.decode_wire(reader, data);
+        reader.finish();
+        return data;
+    });
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "node_data.hpp"
+
+// Primitives of the compact wire format (see wire.hpp): unsigned LEB128
+// varints, 7 bits per byte with the low group first, and zigzag mapping
+// for signed values so small magnitudes stay short.
+
+// "XPW" and the format version, followed in a document by the schema
+// fingerprint as 8 bytes, low byte first
+inline constexpr char wireMagic[4] = {'X', 'P', 'W', 3};
+
+inline void append_wire_header(std::string& out, std::uint64_t fingerprint)
+{
+    out.append(wireMagic, sizeof(wireMagic));
+    for (int i = 0; i < 8; ++i) out += static_cast<char>(fingerprint >> 8 * i);
+}
+
+inline void append_varint(std::string& out, std::uint64_t value)
+{
+    char buffer[10];
+    std::size_t size = 0;
+    for (; value >= 0x80; value >>= 7) buffer[size++] = static_cast<char>(value | 0x80);
+    buffer[size++] = static_cast<char>(value);
+    out.append(buffer, size);
+}
+inline void append_wire_string(std::string& out, std::string_view text)
+{
+    append_varint(out, text.size());
+    out += text;
+}
+inline constexpr std::uint64_t zigzag(std::int64_t value)
+{
+    return static_cast<std::uint64_t>(value) << 1 ^ static_cast<std::uint64_t>(value >> 63);
+}
+inline constexpr std::int64_t unzigzag(std::uint64_t value)
+{
+    return static_cast<std::int64_t>(value >> 1 ^ (0 - (value & 1)));
+}
+
+// Reads the primitives from a buffer; running past its end or an
+// overlong varint is a ParseError with the MalformedWire reason.
+class WireReader
+{
+public:
+    inline explicit WireReader(std::string_view data)
+        : begin(data.data()), p(data.data()), end(data.data() + data.size())
+    { }
+
+    inline std::size_t remaining() const { return static_cast<std::size_t>(end - p); }
+
+    // Checks the header before anything else is read; a document of
+    // another schema is a ParseError with the SchemaMismatch reason
+    inline void header(std::uint64_t fingerprint)
+    {
+        if (remaining() < sizeof(wireMagic) + 8 || std::string_view(p, sizeof(wireMagic)) != std::string_view(wireMagic, sizeof(wireMagic)))
+            fail("not a wire document of this version");
+        p += sizeof(wireMagic);
+        std::uint64_t written = 0;
+        for (int i = 0; i < 8; ++i) written |= std::uint64_t(byte()) << 8 * i;
+        if (written != fingerprint) throw ParseError(ParseError::Reason::SchemaMismatch, "Wire document of another schema");
+    }
+    inline std::uint8_t byte()
+    {
+        if (p == end) fail("unexpected end");
+        return static_cast<std::uint8_t>(*p++);
+    }
+    // The presence byte of an optional field
+    inline bool presence()
+    {
+        auto value = byte();
+        if (value > 1) fail("invalid presence byte");
+        return value;
+    }
+    inline std::uint64_t varint()
+    {
+        // Most lengths and counts fit in one byte
+        if (p != end && !(*p & 0x80)) return static_cast<std::uint8_t>(*p++);
+        std::uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            auto part = byte();
+            if (shift == 63 && part > 1) break;
+            value |= static_cast<std::uint64_t>(part & 0x7f) << shift;
+            if (!(part & 0x80)) return value;
+        }
+        fail("overlong varint");
+    }
+    inline std::string_view string()
+    {
+        auto size = varint();
+        if (size > remaining()) fail("unexpected end");
+        std::string_view text(p, static_cast<std::size_t>(size));
+        p += size;
+        return text;
+    }
+    inline void finish()
+    {
+        if (p != end) fail("unexpected data after the document");
+    }
+    [[noreturn]] inline void fail(const char* what) const
+    {
+        throw ParseError(ParseError::Reason::MalformedWire, "Malformed wire document: "s + what + " at offset " + std::to_string(p - begin));
+    }
+
+private:
+    const char* begin;
+    const char* p;
+    const char* end;
+};
@@ -0,0 +1,366 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+
+// CPUs per NUMA node as reported by sysfs, restricted to the CPUs this
+// process may run on. Falls back to a single node without pinning. Node ids
+// may be sparse, so nodeIds holds the kernel's id of each entry of nodeCpus
+// (entry i is node i where it is missing).
+struct NumaTopology
+{
+    std::vector<std::vector<int>> nodeCpus;
+    std::vector<int> nodeIds;
+    bool pinnable = false;
+
+    static inline std::vector<int> parse_cpu_list(const std::string& list)
+    {
+        std::vector<int> cpus;
+        std::size_t pos = 0;
+        while (pos < list.size())
+        {
+            auto end = list.find(',', pos);
+            if (end == std::string::npos) end = list.size();
+            auto range = list.substr(pos, end - pos);
+            auto dash = range.find('-');
+            try
+            {
+                int first = std::stoi(range);
+                int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+                for (int cpu = first; cpu <= last; ++cpu) cpus.push_back(cpu);
+            }
+            catch (const std::exception&) { }
+            pos = end + 1;
+        }
+        return cpus;
+    }
+
+    static inline NumaTopology detect()
+    {
+        NumaTopology topology;
+#ifdef __linux__
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        bool haveAffinity = sched_getaffinity(0, sizeof(allowed), &allowed) == 0;
+        std::ifstream onlineFile("/sys/devices/system/node/online");
+        std::string online;
+        std::getline(onlineFile, online);
+        for (int node : parse_cpu_list(online))
+        {
+            std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!in) continue;
+            std::string list;
+            std::getline(in, list);
+            std::vector<int> cpus;
+            for (int cpu : parse_cpu_list(list))
+                if (!haveAffinity || CPU_ISSET(cpu, &allowed)) cpus.push_back(cpu);
+            topology.nodeCpus.push_back(std::move(cpus));
+            topology.nodeIds.push_back(node);
+        }
+        topology.pinnable = !topology.nodeCpus.empty();
+#endif
+        if (topology.nodeCpus.empty())
+        {
+            unsigned count = std::max(1u, std::thread::hardware_concurrency());
+            topology.nodeIds = {0};
+            topology.nodeCpus.emplace_back();
+            for (unsigned cpu = 0; cpu < count; ++cpu) topology.nodeCpus.back().push_back(static_cast<int>(cpu));
+        }
+        return topology;
+    }
+};
+
+// Counts outstanding tasks so a submitting thread can wait for them; see
+// WorkerPool::wait for waiting from inside a worker.
+class TaskGroup
+{
+public:
+    inline void add(std::size_t count = 1)
+    {
+        pending.fetch_add(count, std::memory_order_relaxed);
+    }
+    inline void done()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1) finished.notify_all();
+    }
+    // Taking the mutex once the count is zero ensures the last done() has
+    // returned, so the caller may destroy the group afterwards.
+    inline bool idle()
+    {
+        if (pending.load(std::memory_order_acquire)) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        return true;
+    }
+    inline void wait()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        finished.wait(lock, [&] { return pending.load(std::memory_order_acquire) == 0; });
+    }
+
+private:
+    std::atomic<std::size_t> pending{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+};
+
+// Work-stealing worker threads grouped by NUMA node. Each worker is pinned
+// to the CPUs of its node and prefers memory of that node, so everything a
+// task allocates (in particular parsed NodeData) is node local.
+//
+// Tasks submitted from outside go to a queue per node (only workers of that
+// node take them) or to a shared queue for anyNode. Tasks spawned by a
+// running task go to the front of the worker's own deque and are run LIFO;
+// idle workers steal the oldest task of another worker, preferring their
+// own node and never moving a task of a node-bound submission off its node.
+class WorkerPool
+{
+public:
+    static inline constexpr int anyNode = -1;
+
+    inline explicit WorkerPool(std::size_t workersPerNode = 0, NumaTopology topology = NumaTopology::detect())
+        : topology(std::move(topology)), queues(this->topology.nodeCpus.size() + 1)
+    {
+        for (std::size_t node = 0; node < nodes(); ++node)
+        {
+            auto& cpus = this->topology.nodeCpus[node];
+            auto count = cpus.empty() ? 0 : workersPerNode ? workersPerNode : cpus.size();
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                workers.push_back(std::make_unique<Worker>());
+                workers.back()->node = static_cast<int>(node);
+            }
+            workerCounts.push_back(count);
+        }
+        for (std::size_t i = 0; i < workers.size(); ++i)
+            workers[i]->thread = std::thread([this, i] { run(i); });
+    }
+    inline ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wakeup.notify_all();
+        for (auto& worker : workers) worker->thread.join();
+    }
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // The pool whose worker is running on this thread, if any.
+    static inline WorkerPool*& current()
+    {
+        static thread_local WorkerPool* pool = nullptr;
+        return pool;
+    }
+
+    inline std::size_t nodes() const { return topology.nodeCpus.size(); }
+    inline std::size_t workers_on(int node) const
+    {
+        if (node == anyNode) return workers.size();
+        return workerCounts.at(static_cast<std::size_t>(node));
+    }
+
+    // NodeLists with at least twice this many entries are split into
+    // stealable subtasks of this size when parsed on a worker without an
+    // active TextSink or ParseProfiler; 0 disables.
+    std::size_t splitGrain = 512;
+
+    inline void submit(std::function<void()> task, int node = anyNode)
+    {
+        if (node != anyNode && (static_cast<std::size_t>(node) >= nodes() || !workers_on(node)))
+            throw std::out_of_range("No workers on NUMA node " + std::to_string(node));
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue_of(node).push_back({std::move(task), node != anyNode});
+            queued.fetch_add(1, std::memory_order_release);
+            ++generation;
+        }
+        // Only workers of the node may take a node-bound task
+        if (node == anyNode) wakeup.notify_one();
+        else wakeup.notify_all();
+    }
+    // Queues a subtask of the running task on this worker's deque; from
+    // other threads it is the same as submit().
+    inline void spawn(std::function<void()> task)
+    {
+        if (current() != this) return submit(std::move(task));
+        auto& worker = *workers[self()];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            worker.tasks.push_front({std::move(task), pinned()});
+        }
+        queued.fetch_add(1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++generation;
+        }
+        wakeup.notify_one();
+    }
+    // Waits for a group. A worker keeps running tasks while it waits, so
+    // tasks waiting for their subtasks cannot starve the pool.
+    inline void wait(TaskGroup& group)
+    {
+        if (current() != this) return group.wait();
+        while (!group.idle())
+            if (!run_one(self())) std::this_thread::yield();
+    }
+
+private:
+    struct Task
+    {
+        std::function<void()> function;
+        bool pinned;
+    };
+    struct Worker
+    {
+        int node = 0;
+        std::mutex mutex;
+        std::deque<Task> tasks;
+        std::thread thread;
+    };
+
+    static inline std::size_t& self()
+    {
+        static thread_local std::size_t index = 0;
+        return index;
+    }
+    static inline bool& pinned()
+    {
+        static thread_local bool value = false;
+        return value;
+    }
+
+    inline std::deque<Task>& queue_of(int node)
+    {
+        return node == anyNode ? queues.back() : queues[static_cast<std::size_t>(node)];
+    }
+
+    inline void bind(int node)
+    {
+#ifdef __linux__
+        if (!topology.pinnable) return;
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        for (int cpu : topology.nodeCpus[static_cast<std::size_t>(node)]) CPU_SET(cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        unsigned long mask[16] = {};
+        // A topology built by hand may leave out the ids of dense nodes
+        auto index = static_cast<std::size_t>(node);
+        int id = index < topology.nodeIds.size() ? topology.nodeIds[index] : node;
+        if (static_cast<std::size_t>(id) < sizeof(mask) * 8)
+        {
+            mask[id / (sizeof(unsigned long) * 8)] = 1ul << (id % (sizeof(unsigned long) * 8));
+            syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, sizeof(mask) * 8);
+        }
+#endif
+    }
+
+    inline bool take(std::size_t index, Task& task)
+    {
+        auto& worker = *workers[index];
+        {
+            std::lock_guard<std::mutex> lock(worker.mutex);
+            if (!worker.tasks.empty())
+            {
+                task = std::move(worker.tasks.front());
+                worker.tasks.pop_front();
+                return true;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto node : {worker.node, anyNode})
+        {
+            auto& queue = queue_of(node);
+            if (queue.empty()) continue;
+            task = std::move(queue.front());
+            queue.pop_front();
+            return true;
+        }
+        return false;
+    }
+    inline bool steal(std::size_t index, Task& task)
+    {
+        int node = workers[index]->node;
+        for (bool sameNode : {true, false})
+        {
+            for (std::size_t offset = 1; offset < workers.size(); ++offset)
+            {
+                auto& victim = *workers[(index + offset) % workers.size()];
+                if ((victim.node == node) != sameNode) continue;
+                std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+                if (!lock || victim.tasks.empty()) continue;
+                if (!sameNode && victim.tasks.back().pinned) continue;
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+    inline bool run_one(std::size_t index)
+    {
+        Task task;
+        if (!take(index, task) && !steal(index, task)) return false;
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        bool wasPinned = std::exchange(pinned(), task.pinned);
+        task.function();
+        pinned() = wasPinned;
+        return true;
+    }
+
+    inline void run(std::size_t index)
+    {
+        current() = this;
+        self() = index;
+        bind(workers[index]->node);
+        for (;;)
+        {
+            std::uint64_t seen;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                seen = generation;
+            }
+            if (run_one(index)) continue;
+            std::unique_lock<std::mutex> lock(mutex);
+            if (stopping && queued.load(std::memory_order_acquire) == 0) return;
+            // Sleep until something is queued. The timeout covers tasks that
+            // became stealable without a push, e.g. behind a busy victim lock.
+            wakeup.wait_for(lock, std::chrono::milliseconds(1), [&] {
+                return (stopping && queued.load(std::memory_order_acquire) == 0) || generation != seen;
+            });
+        }
+    }
+
+    NumaTopology topology;
+    std::vector<std::deque<Task>> queues;
+    std::vector<std::size_t> workerCounts;
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::atomic<std::size_t> queued{0};
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::uint64_t generation = 0;
+    bool stopping = false;
+};
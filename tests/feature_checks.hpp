@@ -0,0 +1,506 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <xml_parser.hpp>
+#include "example_schema.hpp"
+
+// Checks of parse modes that the random documents of check_round_trips do
+// not reach, each on a small schema of its own. Every check prints what
+// failed and counts as one failure.
+
+inline std::size_t feature_failure(const std::string& what)
+{
+    std::cout << "Feature check failed: " << what << std::endl;
+    return 1;
+}
+
+// Chunked texts reach the active TextSink in chunks of at most the chunk
+// size, as fragments split by comments and CDATA sections too, and are not
+// stored; without a sink they are stored. Also inside a WorkerPool task
+// whose lists are split into subtasks.
+inline std::size_t check_text_sink()
+{
+    auto desc = "r"_node(NodeList("e"_node("id"_attr(Required()), Text(Chunked<4>()))));
+    std::map<std::string, std::string> expected;
+    std::string document = "<r>";
+    for (int i = 0; i < 40; ++i)
+    {
+        auto id = std::to_string(i);
+        auto text = std::string(static_cast<std::size_t>(i % 11), static_cast<char>('a' + i % 26));
+        if (i % 3 == 0) text += "<![CDATA[<x>]]>";
+        document += "<e id=\"" + id + "\">" + text + (i % 5 == 0 ? "<!-- c -->tail" : "") + "</e>";
+        if (i % 3 == 0) text.replace(text.size() - 15, 15, "<x>");
+        expected[id] = text + (i % 5 == 0 ? "tail" : "");
+    }
+    document += "</r>";
+
+    std::size_t failures = 0;
+    auto parse_with_sink = [&](const char* mode) {
+        std::map<std::string, std::string> received;
+        std::map<std::string, int> lasts;
+        bool oversized = false;
+        auto data = parse_chunked(document, desc, [&](const NodeData& node, std::string_view chunk, bool last) {
+            auto& id = node.attributes.at("id");
+            received[id] += chunk;
+            lasts[id] += last;
+            oversized |= chunk.size() > 4;
+        });
+        for (auto& [id, text] : expected)
+        {
+            if (text.empty()) continue;
+            if (received[id] != text || lasts[id] != 1) failures += feature_failure(mode + ": text of "s + id + " not delivered once");
+        }
+        if (oversized) failures += feature_failure(mode + ": chunk larger than the chunk size"s);
+        for (auto& entry : data.subnodes["e"])
+            if (!entry.text.empty()) failures += feature_failure(mode + ": chunked text stored with a sink"s);
+    };
+    parse_with_sink("sink");
+
+    WorkerPool pool(2);
+    pool.splitGrain = 1;
+    TaskGroup group;
+    group.add();
+    pool.submit([&] {
+        parse_with_sink("sink in a pool task");
+        group.done();
+    });
+    pool.wait(group);
+
+    auto stored = parse(document, desc);
+    for (auto& entry : stored.subnodes["e"])
+        if (entry.text != expected[entry.attributes["id"]]) failures += feature_failure("text without a sink not stored");
+    return failures;
+}
+
+// Texts split by comments, processing instructions and CDATA sections are
+// read whole by every reader, and Cdata texts (with "]]>", which has to be
+// split over two sections) are written as CDATA and read back unchanged.
+inline std::size_t check_text_fragments()
+{
+    std::size_t failures = 0;
+    auto plain = "r"_node(Text());
+    auto document = "<r>ab<!-- c -->cd<?pi x?>e<![CDATA[<f>]]>g</r>"s;
+    if (parse(document, plain).text != "abcde<f>g") failures += feature_failure("fragmented text not read whole");
+    if (xml_to_json(document, plain) != "{\"#text\":\"abcde<f>g\"}") failures += feature_failure("fragmented text not transcoded whole");
+
+    auto typed = "r"_node(Text(FixedPoint<2>()));
+    auto value = parse("<r>1<!-- c -->2.5</r>", typed);
+    if (Text(FixedPoint<2>()).get(value) != Decimal{1250, 2}) failures += feature_failure("fragmented typed text not read whole");
+
+    auto cdata = "r"_node(Text(Cdata()));
+    for (std::string text : {"plain", "<a & b>", "x]]>y", "]]>]]>", "]"})
+    {
+        NodeData data;
+        data.name = "r";
+        data.text = text;
+        auto serialized = serialize(data, cdata);
+        if (serialized.find("<![CDATA[") == std::string::npos) failures += feature_failure("Cdata text not written as CDATA: " + serialized);
+        auto reparsed = parse(serialized, cdata);
+        if (reparsed != data || serialize(reparsed, cdata) != serialized) failures += feature_failure("Cdata text does not round trip: " + serialized);
+    }
+    return failures;
+}
+
+// Walks random documents of the example schema with a PullCursor, skipping
+// the rest of some lists, and compares what it reads with parse(). Errors
+// surface when the offending element is reached, and only if it is.
+inline std::size_t check_pull_cursor(std::size_t documents, std::uint64_t seed)
+{
+    auto desc = example_schema();
+    std::mt19937_64 random(seed);
+    std::size_t failures = 0;
+    // The cursor's text of a typed field against the parsed value
+    auto same_value = [](auto type, std::string_view text, const NodeData& data, const char* key) {
+        using Type = decltype(type);
+        auto* value = find_field<Type>(data, key);
+        typename Type::value_type read{};
+        return text.empty() ? !value : value && Type::read(text, read) && read == *value;
+    };
+    for (std::size_t i = 0; i < documents; ++i)
+    {
+        NodeData generated;
+        desc.generate(generated, random);
+        auto serialized = serialize(generated, desc);
+        auto parsed = parse(serialized, desc);
+        auto fail = [&](const char* what) { failures += feature_failure("cursor "s + what + " in " + serialized); };
+        bool skip = i % 2;
+
+        PullCursor cursor(serialized, desc);
+        if (cursor.empty() || cursor.attribute("key") != parsed.attributes["key"]
+            || cursor.attribute("client_id") != "client_id"_attr("anonymous"_default).get(parsed))
+            fail("root attributes differ");
+        std::size_t visited = 0;
+        auto& attachments = parsed.subnodes["attachment"];
+        if (cursor.enter("attachment"))
+        {
+            do
+            {
+                if (visited >= attachments.size()) break;
+                auto& entry = attachments[visited++];
+                if (cursor.attribute("name") != entry.attributes["name"] || !same_value(Base64(), cursor.text(), entry, "#text"))
+                    fail("attachment differs");
+                if (skip)
+                {
+                    cursor.leave();
+                    break;
+                }
+            }
+            while (cursor.next());
+        }
+        if (visited != (skip ? std::min<std::size_t>(1, attachments.size()) : attachments.size())) fail("visited the wrong number of attachments");
+        if (cursor.depth() != 1 || std::strcmp(cursor.name(), "root")) fail("did not return to the root");
+
+        visited = 0;
+        auto& data = parsed.subnodes["data"];
+        if (cursor.enter("data"))
+        {
+            do
+            {
+                if (visited >= data.size()) break;
+                auto& entry = data[visited++];
+                if (cursor.attribute("id") != entry.attributes["id"]
+                    || cursor.attribute("priority") != "priority"_attr("low|normal|high"_enum, "normal"_default).get(entry)
+                    || !same_value(Iso8601(), cursor.attribute("at"), entry, "at")
+                    || !same_value(FixedPoint<2>(), cursor.attribute("amount"), entry, "amount")
+                    || !same_value(Hex(), cursor.attribute("digest"), entry, "digest")
+                    || cursor.text() != entry.text)
+                    fail("data entry differs");
+            }
+            while (cursor.next());
+        }
+        if (visited != data.size()) fail("visited the wrong number of data entries");
+    }
+
+    // An invalid entry is an error once the cursor reaches it, not before
+    auto malformed = "<root key=\"k\"><attachment/><data id=\"1\">a</data><data id=\"2\" priority=\"urgent\">b</data></root>"s;
+    try
+    {
+        PullCursor cursor(malformed, desc);
+        if (!cursor.enter("data") || cursor.text() != "a") failures += feature_failure("cursor did not read the valid entry");
+        cursor.next();
+        failures += feature_failure("cursor accepted an invalid Enum value");
+    }
+    catch (const ParseError& e)
+    {
+        if (e.reason != ParseError::Reason::InvalidValue) failures += feature_failure("cursor error "s + e.what());
+    }
+    try
+    {
+        PullCursor("<root key=\"k\"><data>a</data></root>", desc).enter("data");
+        failures += feature_failure("cursor accepted an entry without its Required attribute");
+    }
+    catch (const ParseError& e)
+    {
+        if (e.reason != ParseError::Reason::MissingAttribute) failures += feature_failure("cursor error "s + e.what());
+    }
+    return failures;
+}
+
+// Logs the events of emit_events, one line each
+struct EventLog
+{
+    std::string log;
+
+    template<std::size_t id>
+    void start_record(std::integral_constant<std::size_t, id>, const char* name) { log += "start " + std::to_string(id) + ' ' + name + '\n'; }
+    template<std::size_t id>
+    void end_record(std::integral_constant<std::size_t, id>) { log += "end " + std::to_string(id) + '\n'; }
+    template<std::size_t id>
+    void field(std::integral_constant<std::size_t, id>, std::string_view value) { log += "field " + std::to_string(id) + ' ' + std::string(value) + '\n'; }
+    template<std::size_t id>
+    void field(std::integral_constant<std::size_t, id>, std::uint8_t index) { log += "field " + std::to_string(id) + " #" + std::to_string(index) + '\n'; }
+};
+
+// The ids of emit_events are fixed by the schema (checked at compile time)
+// and the events follow its declaration order through nested lists and
+// optional nodes, which have no events when absent.
+inline std::size_t check_events()
+{
+    auto desc = "r"_node(
+        "a"_attr(),
+        NodeList("e"_node("id"_attr(), "p"_attr("x|y"_enum), NodeList("s"_node(Text())))),
+        "opt"_node("o"_attr()),
+        Text());
+    using Schema = decltype(desc);
+    static_assert(Schema::recordCount == 4 && Schema::fieldCount == 6);
+    static_assert(Schema::record_id("r") == 0 && Schema::record_id("r/e") == 1 && Schema::record_id("r/e/s") == 2 && Schema::record_id("r/opt") == 3);
+    static_assert(Schema::field_id("r/@a") == 0 && Schema::field_id("r/e/@id") == 1 && Schema::field_id("r/e/@p") == 2);
+    static_assert(Schema::field_id("r/e/s/#text") == 3 && Schema::field_id("r/opt/@o") == 4 && Schema::field_id("r/#text") == 5);
+    static_assert(Schema::field_id("r/@b") == -1 && Schema::field_id("r/e") == -1 && Schema::record_id("r/s") == -1);
+
+    std::size_t failures = 0;
+    auto check = [&](const std::string& document, const std::string& expected) {
+        EventLog handler;
+        emit_events(document, desc, handler);
+        if (handler.log != expected) failures += feature_failure("events of " + document + ":\n" + handler.log);
+    };
+    check("<r a=\"A\"><e id=\"1\" p=\"y\"><s>t1</s><s>t2</s></e><e id=\"2\"/>T</r>",
+          "start 0 r\nfield 0 A\n"
+          "start 1 e\nfield 1 1\nfield 2 #1\nstart 2 s\nfield 3 t1\nend 2\nstart 2 s\nfield 3 t2\nend 2\nend 1\n"
+          "start 1 e\nfield 1 2\nend 1\n"
+          "field 5 T\nend 0\n");
+    check("<r><opt o=\"O\"/></r>", "start 0 r\nstart 3 opt\nfield 4 O\nend 3\nend 0\n");
+    return failures;
+}
+
+// Entries without fields take a byte on the wire, so the count of a list
+// of them is bounded by the document's size like any other.
+inline std::size_t check_empty_wire_entries()
+{
+    std::size_t failures = 0;
+    auto desc = "r"_node(NodeList("tick"_node()));
+    NodeData data;
+    data.name = "r";
+    data.subnodes["tick"].resize(3);
+    for (auto& tick : data.subnodes["tick"]) tick.name = "tick";
+    auto encoded = encode_wire(data, desc);
+    if (decode_wire(encoded, desc) != data) failures += feature_failure("list of empty entries does not round trip on the wire");
+
+    // The count is rejected up front, before the entries are read
+    auto expect_malformed = [&](const std::string& document, const char* error, const char* what) {
+        try
+        {
+            decode_wire(document, desc);
+            failures += feature_failure(what);
+        }
+        catch (const ParseError& e)
+        {
+            if (e.reason != ParseError::Reason::MalformedWire || !std::strstr(e.what(), error)) failures += feature_failure("wire error "s + e.what());
+        }
+    };
+    auto header = encoded.substr(0, sizeof(wireMagic) + 8);
+    auto oversized = header;
+    append_varint(oversized, 5000000);
+    expect_malformed(oversized + std::string(4, '\0'), "list longer", "count of empty entries beyond the document accepted");
+    auto padded = header;
+    append_varint(padded, 1);
+    expect_malformed(padded + "\1", "invalid entry byte", "invalid entry byte accepted");
+    return failures;
+}
+
+// A DocumentSplitter finds the same records whatever the size of the
+// pieces, also with '>' and end tags inside comments, CDATA sections,
+// processing instructions and quoted attribute values; an unfinished
+// record is an error but an unclosed root around the records is not. A
+// record that does not parse is skipped and the stream goes on.
+inline std::size_t check_document_stream()
+{
+    std::size_t failures = 0;
+    auto split = [](const std::string& stream, std::size_t recordDepth, std::size_t piece) {
+        DocumentSplitter splitter(recordDepth);
+        std::vector<std::string> records;
+        for (std::size_t pos = 0; pos < stream.size(); pos += piece)
+            splitter.feed(std::string_view(stream).substr(pos, piece), [&](std::string_view text) { records.emplace_back(text); });
+        splitter.finish();
+        return records;
+    };
+    auto check_pieces = [&](const std::string& stream, std::size_t recordDepth, const std::vector<std::string>& expected) {
+        for (std::size_t piece = 1; piece <= stream.size(); ++piece)
+        {
+            try
+            {
+                if (split(stream, recordDepth, piece) != expected)
+                    return failures += feature_failure("records of " + stream + " in pieces of " + std::to_string(piece));
+            }
+            catch (const ParseError& e)
+            {
+                return failures += feature_failure("splitter error "s + e.what() + " on " + stream);
+            }
+        }
+        return failures;
+    };
+    auto expect_error = [&](const std::string& stream, std::size_t recordDepth, const char* what) {
+        for (std::size_t piece : {std::size_t(1), std::size_t(3), stream.size()})
+        {
+            try
+            {
+                split(stream, recordDepth, piece);
+                failures += feature_failure(what + " accepted: "s + stream);
+            }
+            catch (const ParseError& e)
+            {
+                if (e.reason != ParseError::Reason::MalformedXml) failures += feature_failure("splitter error "s + e.what());
+            }
+        }
+    };
+
+    std::vector<std::string> records = {
+        "<e id=\"a>b\" q='</e>'><!-- </e> > --><![CDATA[</e>]]>]]><?pi </e> > ?>t</e>",
+        "<e id=\"s/>\"/>",
+        "<e\n id='1'><f>x</f><f/></e>",
+    };
+    std::string documents = "<?xml version=\"1.0\"?>\n<!DOCTYPE e [<!ENTITY g \">\">]>\n<!-- <e> -->";
+    for (auto& record : records) documents += record + "\n";
+    check_pieces(documents, 0, records);
+
+    check_pieces("<?xml version=\"1.0\"?><r xmlns=\"u\">" + records[0] + " " + records[1] + records[2] + "</r>", 1, records);
+    check_pieces("<r><!-- > -->" + records[0] + records[1], 1, {records[0], records[1]});
+    check_pieces("<r/>", 1, {});
+
+    expect_error("<e>x</e><e>y", 0, "unfinished record");
+    expect_error("<r><e><!-- </e> -->", 1, "unfinished record");
+    expect_error("<e/><e id=\"x", 0, "unfinished start tag");
+    expect_error("<e/>text", 0, "text outside of a document");
+    expect_error("</e>", 0, "end tag outside of a document");
+
+    auto desc = "e"_node("id"_attr(Required()), Text());
+    std::string stream = "<r><e id=\"1\">a</e><e>b</e><e id=3>c</e><e id=\"4\">d</e>";
+    std::vector<std::string> parsed, skipped;
+    std::istringstream in(stream);
+    auto count = parse_document_stream_skipping(in, desc, [&](NodeData&& data) { parsed.push_back(data.attributes["id"] + data.text); },
+        [&](const ParseError& e, std::string_view text) { skipped.push_back(ParseError::reason_name(e.reason) + " "s + std::string(text)); }, 1, 5);
+    if (count != 2 || parsed != std::vector<std::string>{"1a", "4d"}
+        || skipped != std::vector<std::string>{"missing_attribute <e>b</e>", "malformed_xml <e id=3>c</e>"})
+        failures += feature_failure("malformed records not skipped in " + stream);
+    // A feed that has one record at a time, like a pipe written to slowly,
+    // gets each record parsed before it is asked for the next one
+    struct SlowFeed : std::streambuf
+    {
+        std::vector<std::string> pieces;
+        std::size_t served = 0;
+        std::size_t* records = nullptr;
+        bool heldBack = false;
+
+        int_type underflow() override
+        {
+            if (served == pieces.size()) return traits_type::eof();
+            // The root's start tag is not a record
+            heldBack |= served > 1 && *records + 1 < served;
+            auto& piece = pieces[served++];
+            setg(piece.data(), piece.data(), piece.data() + piece.size());
+            return traits_type::to_int_type(*gptr());
+        }
+    };
+    SlowFeed feed;
+    std::size_t delivered = 0;
+    feed.records = &delivered;
+    feed.pieces.push_back("<r>");
+    for (int i = 0; i < 5; ++i) feed.pieces.push_back("<e id=\"" + std::to_string(i) + "\">x</e>");
+    std::istream slow(&feed);
+    parse_document_stream(slow, desc, [&](NodeData&&) { ++delivered; }, 1);
+    if (delivered != 5 || feed.heldBack) failures += feature_failure("records of a slow stream held back");
+
+    try
+    {
+        std::istringstream again(stream);
+        parse_document_stream(again, desc, [](NodeData&&) { }, 1);
+        failures += feature_failure("malformed record accepted in " + stream);
+    }
+    catch (const ParseError& e)
+    {
+        if (e.reason != ParseError::Reason::MissingAttribute) failures += feature_failure("stream error "s + e.what());
+    }
+    return failures;
+}
+
+// Metrics shards of exited threads are reused rather than piling up, and
+// a registry created where a destroyed one was does not see its shards.
+inline std::size_t check_metrics()
+{
+    std::size_t failures = 0;
+    auto documents = [](const MetricsRegistry& registry) {
+        auto exposition = registry.exposition();
+        auto line = exposition.find("xml_parser_documents_total{schema=\"s\"} ");
+        return line == std::string::npos ? std::string() : exposition.substr(line, exposition.find('\n', line) - line);
+    };
+    MetricsRegistry registry;
+    for (int i = 0; i < 20; ++i)
+        std::thread([&] { registry.record_parse("s", 10, std::chrono::microseconds(1)); }).join();
+    if (registry.shard_count() != 1) failures += feature_failure("metrics shards of exited threads not reused");
+    if (documents(registry) != "xml_parser_documents_total{schema=\"s\"} 20") failures += feature_failure("metrics of exited threads lost");
+
+    for (int i = 0; i < 5; ++i)
+    {
+        auto replaced = std::make_unique<MetricsRegistry>();
+        replaced->record_parse("s", 10, std::chrono::microseconds(1));
+        if (documents(*replaced) != "xml_parser_documents_total{schema=\"s\"} 1") failures += feature_failure("metrics recorded into another registry");
+    }
+    return failures;
+}
+
+// A published result is readable only by its owner by default
+inline std::size_t check_shared_mode()
+{
+    std::size_t failures = 0;
+    auto name = "/xml_parser_tests_" + std::to_string(getpid());
+    NodeData data;
+    data.name = "r";
+    unlink_shared(name);
+    publish_shared(name, data);
+    struct stat status{};
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0 || fstat(fd, &status) || (status.st_mode & 0777) != 0600) failures += feature_failure("shared result not private to its owner");
+    if (fd >= 0) close(fd);
+    if (SharedResult(name).root().to_node_data() != data) failures += feature_failure("shared result not readable by its owner");
+    unlink_shared(name);
+    return failures;
+}
+
+// The compile-time valid() of every field type, which checks Defaults,
+// accepts exactly the texts its read() does: edge cases, written values
+// and random edits of them.
+inline std::size_t check_field_validity(std::uint64_t seed)
+{
+    std::mt19937_64 random(seed);
+    std::size_t failures = 0;
+    auto check = [&](auto type, const char* name, std::vector<std::string> edges) {
+        using Type = decltype(type);
+        const std::string alphabet = "0123456789+-.:=TZtz aAfF/";
+        for (std::size_t i = 0; i < edges.size() + 2000; ++i)
+        {
+            auto text = i < edges.size() ? edges[i] : Type::write(Type::generate(random));
+            for (auto edits = i < edges.size() ? 0 : random() % 3; edits; --edits)
+            {
+                auto pos = text.empty() ? 0 : random() % text.size();
+                char c = alphabet[random() % alphabet.size()];
+                switch (random() % 3)
+                {
+                case 0: text.insert(text.begin() + static_cast<std::ptrdiff_t>(pos), c); break;
+                case 1: if (!text.empty()) text.erase(pos, 1); break;
+                default: if (!text.empty()) text[pos] = c;
+                }
+            }
+            typename Type::value_type value{};
+            if (Type::valid(text) != Type::read(text, value))
+                return failures += feature_failure(name + " valid() and read() disagree on \""s + text + '"');
+        }
+        return failures;
+    };
+    check("low|normal|high"_enum, "Enum", {"", "low", "lo", "lowx", "High"});
+    check(Iso8601(), "Iso8601", {"0000-01-01T00:00:00Z", "0000-01-01T00:00:00+00:01", "9999-12-31T23:59:59-00:01",
+                                 "2024-02-29t00:00:00.5z", "2023-02-29T00:00:00Z", "2024-01-01 00:00:00.1234567890Z",
+                                 "2024-01-01T00:00:00.Z", "2024-01-01T24:00:00Z", "2024-01-01T00:00:00+24:00"});
+    std::vector<std::string> decimals = {"", "-", "+", ".", "0", "-0.", ".5", "1.", "1.2.3", "9223372036854775807",
+                                         "-9223372036854775808", "9223372036854775808", "92233720368547758.07",
+                                         "-92233720368547758.08", "92233720368547758.08", "1.000000000000000000000"};
+    check(FixedPoint<0>(), "FixedPoint<0>", decimals);
+    check(FixedPoint<2>(), "FixedPoint<2>", decimals);
+    check(FixedPoint<18>(), "FixedPoint<18>", decimals);
+    check(Base64(), "Base64", {"", "=", "a", "ab", "ab=", "ab==", "abc=", "abc==", "ab===", "abcd=", " a b\n c d ", "ab== ", "ab=c"});
+    check(Hex(), "Hex", {"", "a", "ab", "AB cd", "abg", " a\tb "});
+    return failures;
+}
+
+inline std::size_t check_features(std::size_t documents, std::uint64_t seed)
+{
+    return check_text_sink() + check_text_fragments() + check_pull_cursor(documents, seed) + check_events()
+        + check_empty_wire_entries() + check_document_stream()
+        + check_metrics() + check_shared_mode() + check_field_validity(seed);
+}
@@ -0,0 +1,16 @@
+#include <xml_parser.hpp>
+
+// Compiled by the invalid_default_* tests, which expect every case but
+// valid to fail: a Default that is not a value of its field type.
+#if defined(INVALID_DEFAULT_ENUM)
+auto schema = "r"_node("p"_attr("low|high"_enum, "urgent"_default));
+#elif defined(INVALID_DEFAULT_ISO8601)
+auto schema = "r"_node("at"_attr(Iso8601(), "2024-02-30T00:00:00Z"_default));
+#elif defined(INVALID_DEFAULT_FIXED_POINT)
+auto schema = "r"_node(Text(FixedPoint<2>(), "1.005"_default));
+#elif defined(INVALID_DEFAULT_HEX)
+auto schema = "r"_node("digest"_attr(Hex(), "abc"_default));
+#else
+auto schema = "r"_node("p"_attr("low|high"_enum, "high"_default), "at"_attr(Iso8601(), "2024-02-29T00:00:00Z"_default),
+                       "digest"_attr(Hex(), "ab cd"_default), "data"_attr(Base64(), "aGk="_default), Text(FixedPoint<2>(), "1.50"_default));
+#endif
@@ -0,0 +1,33 @@
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "example_schema.hpp"
+#include "feature_checks.hpp"
+#include "round_trip.hpp"
+
+// Runs one suite: round_trip (random documents of the example schema
+// through every parse mode) or features (the checks of feature_checks.hpp).
+//
+//     xml_parser_tests round_trip [documents] [seed]
+int main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " round_trip|features [documents] [seed]" << std::endl;
+        return 2;
+    }
+    std::size_t documents = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000;
+    std::uint64_t seed = argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 1;
+
+    std::size_t failures;
+    if (!std::strcmp(argv[1], "round_trip")) failures = check_round_trips(example_schema(), documents, seed);
+    else if (!std::strcmp(argv[1], "features")) failures = check_features(documents, seed);
+    else
+    {
+        std::cerr << "Unknown suite " << argv[1] << std::endl;
+        return 2;
+    }
+    std::cout << argv[1] << ": " << documents << " documents, " << failures << " failures" << std::endl;
+    return failures ? 1 : 0;
+}
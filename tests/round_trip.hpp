@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+#include <xml_parser.hpp>
+
+// Modifies an entry of every list of snapshot (the parse of data) and
+// checks that the original is unchanged and every untouched subtree is
+// shared with it. Returns a description of the first problem, or nullptr.
+inline const char* check_snapshot_sharing(const NodeSnapshot& snapshot, const NodeData& data)
+{
+    auto shares_others = [&](const NodeSnapshot& modified, const std::string& changedList, std::size_t changed) {
+        for (auto& [list, entries] : data.subnodes)
+            for (std::size_t i = 0; i < entries.size(); ++i)
+                if ((list != changedList || i != changed) && !modified.subnode(list, i).same(snapshot.subnode(list, i))) return false;
+        return true;
+    };
+    auto modified = snapshot.with_text({}, snapshot.text() + "x");
+    if (modified.same(snapshot) || modified.text() != data.text + "x" || !shares_others(modified, "", 0)) return "with_text on the root";
+    for (auto& [list, entries] : data.subnodes)
+    {
+        try
+        {
+            snapshot.without_subnode({{list, entries.size()}});
+            return "without_subnode of a missing entry";
+        }
+        catch (const std::out_of_range&) { }
+        if (entries.empty()) continue;
+        auto last = entries.size() - 1;
+        modified = snapshot.with_attribute({{list, last}}, "modified", "1");
+        auto attribute = modified.subnode(list, last).attribute("modified");
+        if (!attribute || *attribute != "1" || !shares_others(modified, list, last)) return "with_attribute";
+        modified = snapshot.without_subnode({{list, last}});
+        if (modified.count(list) != last || !shares_others(modified, list, last)) return "without_subnode";
+    }
+    if (snapshot.to_node_data() != data) return "the original changed";
+    return nullptr;
+}
+
+// Generates random documents conforming to the schema and checks that every
+// parse mode reproduces the generated data from its serialization and that
+// serialization is stable. Returns the number of failing documents.
+template<class NodeDescription>
+inline std::size_t check_round_trips(NodeDescription desc, std::size_t documents, std::uint64_t seed)
+{
+    std::mt19937_64 random(seed);
+    Parser<NodeDescription> parser(desc);
+    ParseProfiler profiler;
+    // Splits every list so the parallel mode exercises stolen subtasks
+    WorkerPool pool(2);
+    pool.splitGrain = 1;
+    std::size_t failures = 0;
+    for (std::size_t i = 0; i < documents; ++i)
+    {
+        NodeData generated;
+        desc.generate(generated, random);
+        auto serialized = serialize(generated, desc);
+
+        std::vector<std::pair<const char*, NodeData>> results;
+        try
+        {
+            results.emplace_back("parse", parse(serialized, desc));
+            results.emplace_back("parser", parser.parse(serialized));
+            results.emplace_back("profiled", parse(serialized, desc, profiler));
+            auto batch = parse_batch(pool, {serialized}, desc);
+            if (batch.errors[0]) std::rethrow_exception(batch.errors[0]);
+            results.emplace_back("parallel", std::move(batch.documents[0]));
+            std::vector<NodeData> records;
+            auto streamed = parse_stream(serialized, desc, [&](NodeData&& record) { records.push_back(std::move(record)); });
+            for (auto& record : records) streamed.subnodes[record.name].push_back(std::move(record));
+            results.emplace_back("streaming", std::move(streamed));
+            auto image = build_shared_image(parse(serialized, desc), NodeDescription::fingerprint());
+            results.emplace_back("shared", view_shared_image(image.data(), image.size(), NodeDescription::fingerprint()).to_node_data());
+            auto snapshot = parse_snapshot(serialized, desc);
+            if (auto problem = check_snapshot_sharing(snapshot, generated))
+            {
+                std::cout << "Document " << i << " snapshot check failed: " << problem << '\n' << serialized << std::endl;
+                ++failures;
+                continue;
+            }
+            results.emplace_back("snapshot", snapshot.to_node_data());
+            results.emplace_back("json", parse_json(xml_to_json(serialized, desc), desc));
+            results.emplace_back("wire", decode_wire(encode_wire(generated, desc), desc));
+        }
+        catch (const std::exception& e)
+        {
+            std::cout << "Document " << i << " failed to parse: " << e.what() << '\n' << serialized << std::endl;
+            ++failures;
+            continue;
+        }
+
+        for (auto& [mode, result] : results)
+        {
+            if (result == generated && serialize(result, desc) == serialized) continue;
+            std::cout << "Document " << i << " does not round trip in mode " << mode << ":\n" << serialized << std::endl;
+            ++failures;
+            break;
+        }
+    }
+    return failures;
+}